@@ -0,0 +1,426 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_alloc.c
+ *
+ *       Allocator benchmark.  Replays the allocations in a memcheck event
+ *       log (see memcheck.h), as written by a program run with
+ *       MEMCHECK_LOG=file, with the C library's malloc() and with the
+ *       size-class allocator of memcheck/slab.c.  Only the allocations
+ *       are replayed, so only the allocator is timed; each new block has
+ *       its first byte written, as the program would write to it.
+ *
+ *       Each allocator runs in a new process of its own (see
+ *       send_script()).  A first pass fills every block and samples the
+ *       process's resident memory every RSS_EVERY steps: its peak growth,
+ *       over the peak of the bytes the program asked for, is what the
+ *       allocator costs in headers, rounding and fragmentation together.
+ *       Then 'passes' more passes are timed, and the best gives the time
+ *       per step.  Blocks the program never freed are freed at the end
+ *       of each pass.
+ *
+ *       usage: bench_alloc logfile [passes]
+ *
+ *       (run_alloc_bench makes logs of lab 6's sorter and of the word
+ *       counter, and runs this on them.)
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "hash_map.h"
+#include "bench_timer.h"
+#include "memlog_read.h"
+#include "memcheck.h"
+#include "slab.h"
+
+/* Steps between samples of the resident memory. */
+#define RSS_EVERY 4096
+
+/* One step of the replay, on the block in slot 'slot'. */
+typedef struct
+{
+  unsigned long size;
+  unsigned int slot;
+  unsigned int op;         /* MEMLOG_ALLOC, MEMLOG_REALLOC or MEMLOG_FREE */
+} step;
+
+/* The steps of a log, and what they add up to. */
+typedef struct
+{
+  step *steps;
+  size_t nsteps;
+  size_t nslots;           /* most blocks live at once, leaks included */
+  unsigned long allocs, reallocs, frees;
+  unsigned long peak_bytes;  /* most bytes live at once */
+} script;
+
+/* An allocator to replay with. */
+typedef struct
+{
+  const char *name;
+  void *(*alloc)(size_t size);
+  void *(*resize)(void *ptr, size_t size);
+  void (*release)(void *ptr);
+} allocator;
+
+static const allocator allocators[] = {
+  { "malloc", malloc, realloc, free },
+  { "slab", slab_malloc, slab_realloc, slab_free }
+};
+
+#define NALLOCATORS ((int) (sizeof(allocators) / sizeof(allocators[0])))
+
+/* The slot of each live block, by address. */
+HASH_MAP_DEFINE(slot_map, unsigned long, unsigned int, hash_map_int_hash,
+                hash_map_int_equal)
+
+
+/* resident_bytes: the process's resident memory, from /proc. */
+static double resident_bytes(void)
+{
+  FILE *f = fopen("/proc/self/statm", "r");
+  unsigned long pages = 0;
+
+  if (f == NULL || fscanf(f, "%*u %lu", &pages) != 1) {
+    fprintf(stderr, "Can't read /proc/self/statm.\n");
+    exit(1);
+  }
+  fclose(f);
+  return (double) pages * sysconf(_SC_PAGESIZE);
+}
+
+
+/* compare_events: qsort comparison of record pointers, by time and
+ * then by place in the log */
+static int compare_events(const void *a, const void *b)
+{
+  const memcheck_event *x = *(memcheck_event * const *) a;
+  const memcheck_event *y = *(memcheck_event * const *) b;
+
+  if (x->time != y->time) {
+    return x->time < y->time ? -1 : 1;
+  }
+  return x < y ? -1 : x > y;
+}
+
+
+/* make_script: turn a log's events into steps in time order, with the
+ * blocks numbered by slot so the replay needs no lookups; a slot is
+ * reused once its block is freed.  Frees and reallocs of blocks the log
+ * didn't see allocated (with sampling, say) are left out.
+ * arguments: records, nrecords: the log
+ *            s: the script to fill in
+ */
+static void make_script(memcheck_event *records, size_t nrecords,
+                        script *s)
+{
+  memcheck_event **events;
+  slot_map *slots = slot_map_create();
+  unsigned long *sizes = NULL;  /* size of the block in each slot */
+  unsigned int *unused = NULL;  /* freed slots */
+  unsigned int *slot, n;
+  size_t nevents = 0, nunused = 0, capacity = 0, i;
+  unsigned long live = 0;
+  int inserted;
+
+  events = (memcheck_event **) malloc(nrecords * sizeof(memcheck_event *));
+  check_alloc(events);
+  for (i = 1; i < nrecords; i++) {
+    if (records[i].op == MEMLOG_SITE) {
+      /* the site's name fills the records after it */
+      i += (records[i].size + sizeof(memcheck_event) - 1) /
+           sizeof(memcheck_event);
+    }
+    else if (records[i].op == MEMLOG_ALLOC ||
+               records[i].op == MEMLOG_REALLOC ||
+               records[i].op == MEMLOG_FREE) {
+      events[nevents++] = &records[i];
+    }
+  }
+  qsort(events, nevents, sizeof(memcheck_event *), compare_events);
+
+  memset(s, 0, sizeof(script));
+  s->steps = (step *) malloc((nevents > 0 ? nevents : 1) * sizeof(step));
+  check_alloc(s->steps);
+  for (i = 0; i < nevents; i++) {
+    memcheck_event *e = events[i];
+    step *st = &s->steps[s->nsteps];
+
+    if (e->op == MEMLOG_ALLOC) {
+      if (nunused > 0) {
+        n = unused[--nunused];
+      }
+      else {
+        if (s->nslots == capacity) {
+          capacity = 2 * capacity + 1024;
+          sizes = (unsigned long *) realloc(sizes, capacity *
+                                            sizeof(unsigned long));
+          unused = (unsigned int *) realloc(unused, capacity *
+                                            sizeof(unsigned int));
+          check_alloc(sizes);
+          check_alloc(unused);
+        }
+        n = (unsigned int) s->nslots++;
+      }
+      /* an address still in the map was leaked and reused; its old
+       * block keeps its slot to the end */
+      *slot_map_put(slots, &e->addr, &inserted) = n;
+      sizes[n] = e->size;
+      live += e->size;
+      s->allocs++;
+    }
+    else {
+      slot = slot_map_get(slots, e->op == MEMLOG_FREE ? &e->addr
+                                                      : &e->old_addr);
+      if (slot == NULL) {
+        continue;
+      }
+      n = *slot;
+      live -= sizes[n];
+      if (e->op == MEMLOG_FREE) {
+        slot_map_remove(slots, &e->addr);
+        unused[nunused++] = n;
+        s->frees++;
+      }
+      else {
+        slot_map_remove(slots, &e->old_addr);
+        *slot_map_put(slots, &e->addr, &inserted) = n;
+        sizes[n] = e->size;
+        live += e->size;
+        s->reallocs++;
+      }
+    }
+    if (live > s->peak_bytes) {
+      s->peak_bytes = live;
+    }
+    st->op = e->op;
+    st->slot = n;
+    st->size = e->size;
+    s->nsteps++;
+  }
+
+  slot_map_free(slots);
+  free(sizes);
+  free(unused);
+  free(events);
+}
+
+
+/* replay: run a script once, and free what it leaves allocated.
+ * arguments: a: the allocator
+ *            s: the script
+ *            blocks: room for s->nslots blocks, all NULL
+ *            peak_rss: if not NULL, where to keep the most resident
+ *                      memory seen, sampled every RSS_EVERY steps; the
+ *                      blocks are then filled, so that all their pages
+ *                      count, where otherwise only their first byte is
+ *                      written
+ */
+static void replay(const allocator *a, const script *s, void **blocks,
+                   double *peak_rss)
+{
+  size_t i;
+  double rss;
+
+  for (i = 0; i < s->nsteps; i++) {
+    const step *st = &s->steps[i];
+
+    switch (st->op) {
+    case MEMLOG_ALLOC:
+    case MEMLOG_REALLOC:
+      blocks[st->slot] = st->op == MEMLOG_ALLOC ? a->alloc(st->size)
+                         : a->resize(blocks[st->slot], st->size);
+      if (st->size == 0) {
+        break;
+      }
+      check_alloc(blocks[st->slot]);
+      if (peak_rss != NULL) {
+        memset(blocks[st->slot], 1, st->size);
+      }
+      else if (st->op == MEMLOG_ALLOC) {
+        *(char *) blocks[st->slot] = 1;
+      }
+      break;
+
+    case MEMLOG_FREE:
+      a->release(blocks[st->slot]);
+      blocks[st->slot] = NULL;
+      break;
+    }
+
+    if (peak_rss != NULL && i % RSS_EVERY == 0) {
+      rss = resident_bytes();
+      if (rss > *peak_rss) {
+        *peak_rss = rss;
+      }
+    }
+  }
+
+  for (i = 0; i < s->nslots; i++) {
+    if (blocks[i] != NULL) {
+      a->release(blocks[i]);
+      blocks[i] = NULL;
+    }
+  }
+}
+
+
+/* measure: replay a script with one allocator and print a line of
+ * results.  Called in a process of its own.
+ * arguments: a: the allocator
+ *            s: the script
+ *            passes: number of timed passes
+ */
+static void measure(const allocator *a, const script *s, int passes)
+{
+  void **blocks;
+  void * volatile *touch;
+  double start, peak, best = 0, t;
+  size_t n = s->nslots > 0 ? s->nslots : 1, j;
+  int i;
+
+  /* filled in now, so its pages count before the replays start, and
+   * through a volatile pointer, or the compiler may make it a calloc()
+   * that leaves them untouched */
+  blocks = (void **) malloc(n * sizeof(void *));
+  check_alloc(blocks);
+  for (touch = blocks, j = 0; j < n; j++) {
+    touch[j] = NULL;
+  }
+
+  start = peak = resident_bytes();
+  replay(a, s, blocks, &peak);
+  for (i = 0; i < passes; i++) {
+    t = bench_seconds();
+    replay(a, s, blocks, NULL);
+    t = bench_seconds() - t;
+    if (i == 0 || t < best) {
+      best = t;
+    }
+  }
+
+  printf("%-8s %10.1f %14.2f %10.2f\n", a->name,
+         s->nsteps > 0 ? best / s->nsteps * 1e9 : 0, (peak - start) / 1e6,
+         s->peak_bytes > 0 ? (peak - start) / s->peak_bytes : 0);
+  free(blocks);
+}
+
+
+/* read_script: read a script written by send_script().
+ * arguments: f: the file
+ *            s: the script to fill in
+ */
+static void read_script(FILE *f, script *s)
+{
+  if (fread(s, sizeof(script), 1, f) != 1) {
+    fprintf(stderr, "Can't read the script.\n");
+    exit(1);
+  }
+  s->steps = (step *) malloc((s->nsteps > 0 ? s->nsteps : 1) *
+                             sizeof(step));
+  check_alloc(s->steps);
+  if (fread(s->steps, sizeof(step), s->nsteps, f) != s->nsteps) {
+    fprintf(stderr, "Can't read the script.\n");
+    exit(1);
+  }
+}
+
+
+/* send_script: run "bench_alloc -replay" to measure one allocator,
+ * sending it the script through a pipe, and wait for it to finish.
+ * The replay starts a new program, rather than just forking, because
+ * the C library's heap would keep the memory this process has freed,
+ * and malloc() would use it for free.
+ * arguments: s: the script
+ *            a: index of the allocator
+ *            passes: number of timed passes
+ * return: 0 on success, or nonzero if the replay failed
+ */
+static int send_script(const script *s, int a, int passes)
+{
+  char index[16], count[16];
+  int fds[2], status;
+  FILE *f;
+  pid_t pid;
+
+  sprintf(index, "%d", a);
+  sprintf(count, "%d", passes);
+  fflush(stdout);
+  if (pipe(fds) < 0 || (pid = fork()) < 0) {
+    perror("bench_alloc");
+    exit(1);
+  }
+  if (pid == 0) {
+    dup2(fds[0], 0);
+    close(fds[0]);
+    close(fds[1]);
+    execl("/proc/self/exe", "bench_alloc", "-replay", index, count,
+          (char *) NULL);
+    perror("bench_alloc");
+    _exit(1);
+  }
+
+  close(fds[0]);
+  f = fdopen(fds[1], "wb");
+  if (f == NULL || fwrite(s, sizeof(script), 1, f) != 1 ||
+      fwrite(s->steps, sizeof(step), s->nsteps, f) != s->nsteps) {
+    perror("bench_alloc");
+    exit(1);
+  }
+  fclose(f);
+  return waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+         WEXITSTATUS(status) != 0;
+}
+
+
+int main(int argc, char **argv)
+{
+  memcheck_event *records;
+  script s;
+  size_t nrecords;
+  int passes = argc > 2 ? atoi(argv[2]) : 5, i;
+
+  /* the replay of one allocator, run by send_script() */
+  if (argc == 4 && strcmp(argv[1], "-replay") == 0) {
+    i = atoi(argv[2]);
+    if (i < 0 || i >= NALLOCATORS) {
+      return 1;
+    }
+    read_script(stdin, &s);
+    measure(&allocators[i], &s, atoi(argv[3]));
+    free(s.steps);
+    return 0;
+  }
+
+  if (argc < 2 || argc > 3 || passes < 1) {
+    fprintf(stderr, "usage: %s logfile [passes]\n", argv[0]);
+    return 1;
+  }
+  records = read_log(argv[1], &nrecords);
+  make_script(records, nrecords, &s);
+  free(records);
+
+  printf("%s: %lu steps (%lu allocs, %lu reallocs, %lu frees); "
+         "peak %.2f MB live in up to %lu blocks\n\n", argv[1],
+         (unsigned long) s.nsteps, s.allocs, s.reallocs, s.frees,
+         s.peak_bytes / 1e6, (unsigned long) s.nslots);
+  printf("%-8s %10s %14s %10s\n", "", "ns/step", "peak RSS (MB)",
+         "RSS/live");
+
+  for (i = 0; i < NALLOCATORS; i++) {
+    if (send_script(&s, i, passes) != 0) {
+      fprintf(stderr, "The %s replay failed.\n", allocators[i].name);
+      return 1;
+    }
+  }
+
+  free(s.steps);
+  return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_hash_map.c
+ *
+ *       Benchmark of several instantiations of the generic hash map
+ *       against the chained hash table:
+ *
+ *         u64     64-bit integer keys, int values; the chained table
+ *                 holds the same keys written out in decimal
+ *         word    string keys pointing into a key buffer; the chained
+ *                 table copies them
+ *         point   two-int struct keys, struct values (no chained
+ *                 equivalent)
+ *
+ *       Each table gets every key once and is then probed with a stream
+ *       of present keys.  Memory is counted without malloc's overhead;
+ *       the word map's characters stay in the key buffer and aren't
+ *       counted.
+ *
+ *       usage: bench_hash_map [nkeys [nlookups]]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_table.h"
+#include "hash_map.h"
+#include "word_map.h"
+#include "table_stats.h"
+#include "bench_timer.h"
+#include "key_gen.h"
+#include "memcheck.h"
+
+/* Longest generated key, including the zero byte. */
+#define KEY_SIZE 24
+
+typedef struct
+{
+  int x, y;
+} point;
+
+typedef struct
+{
+  long sum;
+  int n;
+} point_stats;
+
+HASH_MAP_DEFINE(u64_map, uint64_t, int, hash_map_int_hash,
+                hash_map_int_equal)
+HASH_MAP_DEFINE(point_map, point, point_stats, hash_map_bytes_hash,
+                hash_map_bytes_equal)
+HASH_MAP_FUNCTIONS(word_map, word_key, int, word_key_hash, word_key_equal)
+
+
+/* report: print one line of results.
+ * arguments: name: what was measured
+ *            insert, lookup: seconds spent on inserts and on lookups
+ *            bytes: memory used
+ *            nkeys, nlookups: number of inserts and of lookups
+ */
+static void report(const char *name, double insert, double lookup,
+                   size_t bytes, long nkeys, long nlookups)
+{
+  printf("%-14s %10.1f %10.1f %10.1f\n", name, insert * 1e9 / nkeys,
+         lookup * 1e9 / nlookups, (double) bytes / nkeys);
+}
+
+
+int main(int argc, char **argv)
+{
+  long nkeys = 200000, nlookups = 2000000, i, sum = 0;
+  unsigned long state = 42;
+  char (*text)[KEY_SIZE];
+  uint64_t *ints;
+  long *order;
+  double start, insert;
+  hash_table *ht;
+  u64_map *um;
+  word_map *wm;
+  point_map *pm;
+  word_key wk;
+  point p;
+  point_stats *ps;
+  int inserted;
+
+  if (argc > 1) {
+    nkeys = atol(argv[1]);
+  }
+  if (argc > 2) {
+    nlookups = atol(argv[2]);
+  }
+  if (argc > 3 || nkeys < 1 || nlookups < 1) {
+    fprintf(stderr, "usage: %s [nkeys [nlookups]]\n", argv[0]);
+    return 1;
+  }
+
+  /* the keys, and a random order to look them up in */
+  text = (char (*)[KEY_SIZE]) malloc(nkeys * KEY_SIZE);
+  ints = (uint64_t *) malloc(nkeys * sizeof(uint64_t));
+  order = (long *) malloc(nlookups * sizeof(long));
+  if (text == NULL || ints == NULL || order == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    return 1;
+  }
+  for (i = 0; i < nkeys; i++) {
+    ints[i] = (uint64_t) key_random(&state) << 31 | key_random(&state);
+    sprintf(text[i], "%lu", (unsigned long) ints[i]);
+  }
+  for (i = 0; i < nlookups; i++) {
+    order[i] = (long) (key_random(&state) % nkeys);
+  }
+
+  printf("%ld keys, %ld lookups\n", nkeys, nlookups);
+  printf("%-14s %10s %10s %10s\n", "table", "insert ns", "lookup ns",
+         "bytes/key");
+
+  /* integer keys */
+  um = u64_map_create();
+  start = bench_seconds();
+  for (i = 0; i < nkeys; i++) {
+    (*u64_map_put(um, &ints[i], &inserted))++;
+  }
+  insert = bench_seconds() - start;
+  start = bench_seconds();
+  for (i = 0; i < nlookups; i++) {
+    sum += *u64_map_get(um, &ints[order[i]]);
+  }
+  report("u64 map", insert, bench_seconds() - start,
+         sizeof(u64_map) + um->capacity * (1 + sizeof(u64_map_entry)),
+         nkeys, nlookups);
+  u64_map_free(um);
+
+  ht = create_hash_table();
+  start = bench_seconds();
+  for (i = 0; i < nkeys; i++) {
+    add_value(ht, text[i], strlen(text[i]), 1);
+  }
+  insert = bench_seconds() - start;
+  start = bench_seconds();
+  for (i = 0; i < nlookups; i++) {
+    sum += get_value(ht, text[order[i]]);
+  }
+  report("u64 chained", insert, bench_seconds() - start, table_bytes(ht),
+         nkeys, nlookups);
+  free_hash_table(ht);
+
+  /* string keys (the same digits) */
+  wm = word_map_create();
+  start = bench_seconds();
+  for (i = 0; i < nkeys; i++) {
+    wk.s = text[i];
+    wk.len = strlen(text[i]);
+    wk.hash = hash64(wk.s, wk.len);
+    (*word_map_put(wm, &wk, &inserted))++;
+  }
+  insert = bench_seconds() - start;
+  start = bench_seconds();
+  for (i = 0; i < nlookups; i++) {
+    wk.s = text[order[i]];
+    wk.len = strlen(wk.s);
+    wk.hash = hash64(wk.s, wk.len);
+    sum += *word_map_get(wm, &wk);
+  }
+  report("word map", insert, bench_seconds() - start,
+         sizeof(word_map) + wm->capacity * (1 + sizeof(word_map_entry)),
+         nkeys, nlookups);
+  word_map_free(wm);
+
+  /* struct keys and values */
+  pm = point_map_create();
+  start = bench_seconds();
+  for (i = 0; i < nkeys; i++) {
+    p.x = (int) (ints[i] >> 32);
+    p.y = (int) (ints[i] & 0xFFFFFFFF);
+    ps = point_map_put(pm, &p, &inserted);
+    ps->sum += i;
+    ps->n++;
+  }
+  insert = bench_seconds() - start;
+  start = bench_seconds();
+  for (i = 0; i < nlookups; i++) {
+    p.x = (int) (ints[order[i]] >> 32);
+    p.y = (int) (ints[order[i]] & 0xFFFFFFFF);
+    sum += point_map_get(pm, &p)->n;
+  }
+  report("point map", insert, bench_seconds() - start,
+         sizeof(point_map) + pm->capacity * (1 + sizeof(point_map_entry)),
+         nkeys, nlookups);
+  point_map_free(pm);
+
+  /* every lookup found a key that was added once, in all four tables */
+  if (sum != 4 * nlookups) {
+    fprintf(stderr, "wrong values found!\n");
+    return 1;
+  }
+  free(text);
+  free(ints);
+  free(order);
+  return 0;
+}
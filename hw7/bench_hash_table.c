@@ -0,0 +1,203 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_hash_table.c
+ *
+ *       Lookup benchmark for the hash table implementations.  Each table
+ *       is filled with the same keys and then probed with a hit-heavy
+ *       (90% present keys) and a miss-heavy (90% absent keys) stream.
+ *       Where perf events are available, cache misses per lookup are
+ *       reported next to the time.  The memory each table uses (not
+ *       counting malloc's own overhead) is reported per key.  The
+ *       Bloom filter in front of the chained table is run with
+ *       'bloom_bits' bits per key, and its false-positive rate is
+ *       measured on the absent keys.
+ *
+ *       usage: bench_hash_table [nkeys [nlookups [bloom_bits]]]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_table.h"
+#include "bloom_filter.h"
+#include "bench_tables.h"
+#include "perf_counters.h"
+#include "bench_timer.h"
+#include "key_gen.h"
+#include "memcheck.h"
+
+/* Longest generated key, including the zero byte. */
+#define KEY_SIZE 24
+
+
+/* make_lookups: build a stream of lookup keys.
+ * arguments: present, absent: key sets to draw from ('n' keys each)
+ *            n: number of keys in each set
+ *            nlookups: length of the stream
+ *            hit_percent: percentage of lookups drawn from 'present'
+ * return: array of 'nlookups' pointers into the key sets
+ */
+static const char **make_lookups(char (*present)[KEY_SIZE],
+                                 char (*absent)[KEY_SIZE], long n,
+                                 long nlookups, int hit_percent)
+{
+  const char **stream;
+  unsigned long state = 42, r;
+  long i;
+
+  stream = (const char **) malloc(nlookups * sizeof(char *));
+  if (stream == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  for (i = 0; i < nlookups; i++) {
+    r = key_random(&state);
+    stream[i] = (long) (r % 100) < hit_percent ? present[(r >> 7) % n]
+                                                : absent[(r >> 7) % n];
+  }
+  return stream;
+}
+
+
+/* run_lookups: time a stream of lookups and print the result.
+ * arguments: impl: table implementation
+ *            t: filled table
+ *            stream, nlookups: the lookups
+ *            counter: cache-miss counter, or -1
+ */
+static void run_lookups(const table_impl *impl, void *t,
+                        const char **stream, long nlookups, int counter)
+{
+  double start, elapsed;
+  uint64_t misses;
+  long i, sum = 0;
+
+  start_counter(counter);
+  start = bench_seconds();
+  for (i = 0; i < nlookups; i++) {
+    sum += impl->get(t, stream[i], strlen(stream[i]));
+  }
+  elapsed = bench_seconds() - start;
+  misses = stop_counter(counter);
+
+  /* uses 'sum' so the lookups can't be optimized away */
+  if (sum < 0) {
+    printf("%ld\n", sum);
+  }
+  printf(" %10.1f", elapsed * 1e9 / nlookups);
+  if (counter >= 0) {
+    printf(" %10.2f", (double) misses / nlookups);
+  }
+  else {
+    printf(" %10s", "n/a");
+  }
+}
+
+
+/* report_bloom: measure the Bloom filter's false-positive rate.
+ * arguments: present, absent: key sets ('n' keys each)
+ *            n: number of keys in each set
+ */
+static void report_bloom(char (*present)[KEY_SIZE], char (*absent)[KEY_SIZE],
+                         long n)
+{
+  hash_table *ht = create_hash_table();
+  long i, false_positives = 0;
+
+  set_bloom_filter(ht, bench_bloom_bits);
+  for (i = 0; i < n; i++) {
+    add_value(ht, present[i], strlen(present[i]), 1);
+  }
+  for (i = 0; i < n; i++) {
+    false_positives += bloom_may_contain(ht->bloom,
+                                         hash64(absent[i], strlen(absent[i])));
+  }
+  printf("bloom filter: %d bits/key, %d probes, %.2f%% false positives\n",
+         bench_bloom_bits, ht->bloom->nprobes, 100.0 * false_positives / n);
+  free_hash_table(ht);
+}
+
+
+int main(int argc, char **argv)
+{
+  long nkeys = 20000, nlookups = 1000000, i;
+  char (*present)[KEY_SIZE], (*absent)[KEY_SIZE];
+  const char **hits, **misses;
+  double start;
+  size_t j;
+  int counter;
+  void *t;
+
+  if (argc > 1) {
+    nkeys = atol(argv[1]);
+  }
+  if (argc > 2) {
+    nlookups = atol(argv[2]);
+  }
+  if (argc > 3) {
+    bench_bloom_bits = atoi(argv[3]);
+  }
+  if (argc > 4 || nkeys < 1 || nlookups < 1 || bench_bloom_bits < 1) {
+    fprintf(stderr, "usage: %s [nkeys [nlookups [bloom_bits]]]\n", argv[0]);
+    return 1;
+  }
+
+  present = (char (*)[KEY_SIZE]) malloc(nkeys * KEY_SIZE);
+  absent = (char (*)[KEY_SIZE]) malloc(nkeys * KEY_SIZE);
+  if (present == NULL || absent == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    return 1;
+  }
+  for (i = 0; i < nkeys; i++) {
+    sprintf(present[i], "word%ld", i);
+    sprintf(absent[i], "miss%ld", i);
+  }
+  hits = make_lookups(present, absent, nkeys, nlookups, 90);
+  misses = make_lookups(present, absent, nkeys, nlookups, 10);
+
+  counter = open_cache_miss_counter();
+  printf("%ld keys, %ld lookups per workload\n", nkeys, nlookups);
+  printf("%-11s %10s %21s %21s %10s\n", "", "", "hit-heavy", "miss-heavy",
+         "");
+  printf("%-11s %10s %10s %10s %10s %10s %10s\n", "table", "insert ns",
+         "ns", "LLC miss", "ns", "LLC miss", "bytes/key");
+  for (j = 0; j < bench_ntables; j++) {
+    t = bench_tables[j].create();
+    start = bench_seconds();
+    for (i = 0; i < nkeys; i++) {
+      bench_tables[j].add(t, present[i], strlen(present[i]));
+    }
+    if (bench_tables[j].finish != NULL) {
+      bench_tables[j].finish(t);
+    }
+    printf("%-11s %10.1f", bench_tables[j].name,
+           (bench_seconds() - start) * 1e9 / nkeys);
+    run_lookups(&bench_tables[j], t, hits, nlookups, counter);
+    run_lookups(&bench_tables[j], t, misses, nlookups, counter);
+    printf(" %10.1f\n", (double) bench_tables[j].bytes(t) / nkeys);
+
+    /* every key was added once */
+    for (i = 0; i < nkeys; i++) {
+      if (bench_tables[j].get(t, present[i], strlen(present[i])) != 1 ||
+          bench_tables[j].get(t, absent[i], strlen(absent[i])) != 0) {
+        fprintf(stderr, "%s: wrong value for %s!\n", bench_tables[j].name,
+                present[i]);
+        return 1;
+      }
+    }
+    bench_tables[j].destroy(t);
+  }
+
+  report_bloom(present, absent, nkeys);
+
+  close_counter(counter);
+  free(hits);
+  free(misses);
+  free(present);
+  free(absent);
+  return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_latency.c
+ *
+ *       Insert latency of the hash table with and without incremental
+ *       resizing.  Every insert is timed on its own; the report gives
+ *       percentiles and a power-of-two histogram of the latencies.
+ *
+ *       usage: bench_latency [nkeys]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_table.h"
+#include "bench_timer.h"
+#include "memcheck.h"
+
+/* Number of power-of-two histogram buckets (1 ns up to about 1 s). */
+#define NBUCKETS 31
+
+
+/* compare_doubles: qsort comparison for ascending doubles */
+static int compare_doubles(const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+
+/* run: insert 'nkeys' distinct keys, timing each insert, and report.
+ * arguments: nkeys: number of keys to insert
+ *            incremental: 1 to resize incrementally
+ *            lat: scratch array of 'nkeys' latencies
+ */
+static void run(long nkeys, int incremental, double *lat)
+{
+  hash_table *ht = create_hash_table();
+  long hist[NBUCKETS], i;
+  char key[24];
+  double t, total = 0;
+  size_t len;
+  int b;
+
+  set_incremental_resize(ht, incremental);
+  memset(hist, 0, sizeof(hist));
+  for (i = 0; i < nkeys; i++) {
+    len = (size_t) sprintf(key, "key%ld", i);
+    t = bench_seconds();
+    add_value(ht, key, len, 1);
+    lat[i] = (bench_seconds() - t) * 1e9;
+    total += lat[i];
+    for (b = 0; b < NBUCKETS - 1 && lat[i] >= (double) (2L << b); b++) {
+    }
+    hist[b]++;
+  }
+  free_hash_table(ht);
+
+  qsort(lat, nkeys, sizeof(double), compare_doubles);
+  printf("%s resizing: mean %.0f ns, p50 %.0f ns, p99 %.0f ns, "
+         "p99.9 %.0f ns, max %.0f ns\n",
+         incremental ? "incremental" : "stop-the-world", total / nkeys,
+         lat[nkeys / 2], lat[nkeys / 100 * 99], lat[nkeys / 1000 * 999],
+         lat[nkeys - 1]);
+  for (b = 0; b < NBUCKETS; b++) {
+    if (hist[b] != 0) {
+      printf("  < %10ld ns: %ld\n", 2L << b, hist[b]);
+    }
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  long nkeys = 4000000;
+  double *lat;
+
+  if (argc > 1) {
+    nkeys = atol(argv[1]);
+  }
+  if (argc > 2 || nkeys < 1000) {
+    fprintf(stderr, "usage: %s [nkeys >= 1000]\n", argv[0]);
+    return 1;
+  }
+
+  lat = (double *) malloc(nkeys * sizeof(double));
+  if (lat == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    return 1;
+  }
+  run(nkeys, 0, lat);
+  run(nkeys, 1, lat);
+  free(lat);
+  return 0;
+}
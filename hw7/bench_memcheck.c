@@ -0,0 +1,195 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_memcheck.c
+ *
+ *       Cost of memory tracking.  A window of 'live' blocks is kept
+ *       allocated; each step frees the oldest block and allocates a new
+ *       one (first in, first out, the worst order for a list of blocks
+ *       kept newest first).  The same steps are timed with the checked
+ *       functions, with the checked functions sampling one allocation
+ *       per SAMPLE_INTERVAL bytes, and with the C library's own malloc()
+ *       and free().
+ *
+ *       The steps are then shared out among 1, 2, 4, ... up to
+ *       'threads' threads, each with a window of its own, to measure
+ *       how tracking scales.  Each line gives the wall-clock time per
+ *       step, so perfect scaling halves it as the threads double (given
+ *       as many cores).  The windows are freed by the main thread, so
+ *       blocks are also freed by a thread other than the one that
+ *       allocated them.
+ *
+ *       usage: bench_memcheck [pairs [live [threads]]]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "bench_timer.h"
+#include "memcheck.h"
+
+/* Largest block allocated, in bytes. */
+#define MAX_BLOCK 64
+
+/* Bytes between sampled allocations, on average, in the sampled runs. */
+#define SAMPLE_INTERVAL (512 * 1024)
+
+/* Most threads run at once. */
+#define MAX_THREADS 64
+
+/* The work of one thread. */
+typedef struct
+{
+  pthread_t thread;
+  long pairs;      /* number of steps */
+  long live;       /* number of blocks kept allocated */
+  char **window;   /* the live blocks */
+  int checked;     /* 1 to go through memcheck, 0 for the C library */
+} bench_job;
+
+
+/* fill_window: allocate a job's window of blocks. */
+static void fill_window(bench_job *job)
+{
+  long i;
+
+  /* (malloc)(n) calls the function, not memcheck's macro */
+  for (i = 0; i < job->live; i++) {
+    job->window[i] = job->checked ? malloc(i % MAX_BLOCK + 1)
+                                  : (malloc)(i % MAX_BLOCK + 1);
+  }
+}
+
+
+/* free_window: free a job's window of blocks. */
+static void free_window(bench_job *job)
+{
+  long i;
+
+  for (i = 0; i < job->live; i++) {
+    if (job->checked) {
+      free(job->window[i]);
+    }
+    else {
+      (free)(job->window[i]);
+    }
+  }
+}
+
+
+/* run_steps: thread function doing a job's free/malloc steps. */
+static void *run_steps(void *arg)
+{
+  bench_job *job = (bench_job *) arg;
+  char **window = job->window;
+  long live = job->live, i;
+
+  if (job->checked) {
+    for (i = 0; i < job->pairs; i++) {
+      free(window[i % live]);
+      window[i % live] = malloc(i % MAX_BLOCK + 1);
+    }
+  }
+  else {
+    for (i = 0; i < job->pairs; i++) {
+      (free)(window[i % live]);
+      window[i % live] = (malloc)(i % MAX_BLOCK + 1);
+    }
+  }
+  return NULL;
+}
+
+
+/* run: time 'pairs' free/malloc steps over windows of 'live' blocks.
+ * arguments: pairs: number of steps, shared out among the threads
+ *            live: number of blocks kept allocated by each thread
+ *            nthreads: number of threads (1 runs in the main thread)
+ *            jobs: 'nthreads' jobs, each with a window of 'live' pointers
+ *            checked: 1 to go through memcheck, 0 for the C library
+ * return: wall-clock nanoseconds per malloc/free pair
+ */
+static double run(long pairs, long live, int nthreads, bench_job *jobs,
+                  int checked)
+{
+  double start;
+  int i;
+
+  for (i = 0; i < nthreads; i++) {
+    jobs[i].pairs = pairs / nthreads + (i < pairs % nthreads);
+    jobs[i].live = live;
+    jobs[i].checked = checked;
+    fill_window(&jobs[i]);
+  }
+
+  start = bench_seconds();
+  if (nthreads == 1) {
+    run_steps(&jobs[0]);
+  }
+  else {
+    for (i = 0; i < nthreads; i++) {
+      if (pthread_create(&jobs[i].thread, NULL, run_steps, &jobs[i]) != 0) {
+        fprintf(stderr, "Error creating thread.\n");
+        exit(1);
+      }
+    }
+    for (i = 0; i < nthreads; i++) {
+      pthread_join(jobs[i].thread, NULL);
+    }
+  }
+  start = bench_seconds() - start;
+
+  for (i = 0; i < nthreads; i++) {
+    free_window(&jobs[i]);
+  }
+  return start * 1e9 / pairs;
+}
+
+
+int main(int argc, char **argv)
+{
+  long pairs = argc > 1 ? atol(argv[1]) : 10000000;
+  long live = argc > 2 ? atol(argv[2]) : 100000;
+  int max_threads = argc > 3 ? atoi(argv[3]) : 4, nthreads, i;
+  double plain, checked, sampled;
+  bench_job jobs[MAX_THREADS];
+
+  if (argc > 4 || pairs < 1 || live < 1 || max_threads < 1 ||
+      max_threads > MAX_THREADS) {
+    fprintf(stderr, "usage: %s [pairs [live [threads]]]\n", argv[0]);
+    return 1;
+  }
+  for (i = 0; i < max_threads; i++) {
+    jobs[i].window = (char **) (malloc)(live * sizeof(char *));
+    if (jobs[i].window == NULL) {
+      fprintf(stderr, "Error allocating memory.\n");
+      return 1;
+    }
+  }
+
+  printf("%ld malloc/free pairs, %ld live blocks per thread\n", pairs, live);
+  printf("%7s %12s %20s %20s\n", "threads", "C library", "memcheck",
+         "sampled");
+  /* doubling the threads, and ending with max_threads */
+  for (nthreads = 1; ; nthreads = 2 * nthreads < max_threads ?
+                                  2 * nthreads : max_threads) {
+    plain = run(pairs, live, nthreads, jobs, 0);
+    checked = run(pairs, live, nthreads, jobs, 1);
+    set_memory_sampling(SAMPLE_INTERVAL);
+    sampled = run(pairs, live, nthreads, jobs, 1);
+    set_memory_sampling(0);
+    printf("%7d %9.1f ns %9.1f ns (%4.1fx) %9.1f ns (%4.1fx)\n", nthreads,
+           plain, checked, checked / plain, sampled, sampled / plain);
+    if (nthreads == max_threads) {
+      break;
+    }
+  }
+
+  for (i = 0; i < max_threads; i++) {
+    (free)(jobs[i].window);
+  }
+  print_memory_leaks();
+  return 0;
+}
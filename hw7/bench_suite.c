@@ -0,0 +1,258 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_suite.c
+ *
+ *       The table benchmark suite.  For each key distribution (see
+ *       key_gen.h) and each stream length from 1,000 tokens up by
+ *       factors of ten, every table implementation runs four workloads
+ *       of that many operations:
+ *
+ *         insert   add 1 to each key of the stream (insert or increment)
+ *         hit      look up the same stream again, so every lookup hits
+ *         miss     look up absent keys drawn the same way
+ *         mixed    half hits, a quarter misses and a quarter adds,
+ *                  interleaved (not run on read-only tables)
+ *
+ *       Each line gives nanoseconds per operation, table bytes per
+ *       distinct key, and the peak resident set size of the process,
+ *       in total and above what the keys themselves take (making
+ *       adversarial keys briefly needs 2 MB, which hides small tables).
+ *       Every table runs in a child process of its own so its peak is
+ *       its own.
+ *
+ *       Streams are generated in batches outside the timed loops, so
+ *       even 100,000,000 tokens need no more memory than the keys.
+ *       Adversarial keys all share one chain or probe sequence, so that
+ *       distribution stops at 100,000 tokens.
+ *
+ *       usage: bench_suite [max_tokens [zipf|uniform|adversarial]]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "bench_tables.h"
+#include "key_gen.h"
+#include "bench_timer.h"
+#include "memcheck.h"
+
+/* Operations generated and then timed at a time. */
+#define BATCH 4096
+
+/* Longest stream of adversarial keys. */
+#define ADVERSARIAL_MAX_TOKENS 100000
+
+/* Seeds of the insert stream (replayed by the hit workload) and of the
+ * others. */
+#define INSERT_SEED 1
+#define MISS_SEED 2
+#define MIXED_SEED 3
+
+typedef enum
+{
+  WORK_INSERT,
+  WORK_HIT,
+  WORK_MISS,
+  WORK_MIXED
+} workload;
+
+/* One batch of operations. */
+typedef struct
+{
+  size_t key[BATCH];  /* index in the key set */
+  char add[BATCH];    /* 1 to add, 0 to look up */
+} batch;
+
+
+/* peak_rss: peak resident set size of this process in megabytes */
+static double peak_rss(void)
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss / 1024.0;  /* Linux reports kilobytes */
+}
+
+
+/* fill_batch: generate the next operations of a workload.
+ * arguments: b: batch to fill
+ *            n: number of operations
+ *            ks: key set
+ *            w: the workload
+ *            state: random number generator state
+ *            seen: if not NULL, marks every key added
+ */
+static void fill_batch(batch *b, size_t n, const key_set *ks, workload w,
+                       unsigned long *state, char *seen)
+{
+  unsigned long r;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    r = w == WORK_MIXED ? key_random(state) % 4 : 0;
+    b->key[i] = draw_key(ks, state);
+    b->add[i] = w == WORK_INSERT || r == 3;
+    if (w == WORK_MISS || r == 2) {
+      b->key[i] += ks->nkeys;
+    }
+    if (seen != NULL && b->add[i]) {
+      seen[b->key[i]] = 1;
+    }
+  }
+}
+
+
+/* run_workload: time one workload.
+ * arguments: impl, t: the table
+ *            ks: key set
+ *            w: the workload
+ *            ntokens: number of operations
+ *            seen: if not NULL, marks every key added
+ * return: nanoseconds per operation
+ */
+static double run_workload(const table_impl *impl, void *t, const key_set *ks,
+                           workload w, size_t ntokens, char *seen)
+{
+  static batch b;
+  unsigned long state = w == WORK_INSERT || w == WORK_HIT ? INSERT_SEED :
+                        w == WORK_MISS ? MISS_SEED : MIXED_SEED;
+  size_t done, n, i, k, hits = 0;
+  double elapsed = 0, start;
+
+  for (done = 0; done < ntokens; done += n) {
+    n = ntokens - done < BATCH ? ntokens - done : BATCH;
+    fill_batch(&b, n, ks, w, &state, seen);
+    start = bench_seconds();
+    for (i = 0; i < n; i++) {
+      k = b.key[i];
+      if (b.add[i]) {
+        impl->add(t, KEY_AT(ks, k), KEY_LEN(ks, k));
+      }
+      else {
+        hits += impl->get(t, KEY_AT(ks, k), KEY_LEN(ks, k)) != 0;
+      }
+    }
+    elapsed += bench_seconds() - start;
+  }
+
+  if ((w == WORK_HIT && hits != ntokens) || (w == WORK_MISS && hits != 0)) {
+    fprintf(stderr, "%s: %lu of %lu lookups found their key!\n", impl->name,
+            (unsigned long) hits, (unsigned long) ntokens);
+    exit(1);
+  }
+  return elapsed * 1e9 / ntokens;
+}
+
+
+/* run_table: run every workload on one table and print its line.
+ * arguments: impl: the table implementation
+ *            dist: key distribution
+ *            ntokens: length of each workload
+ */
+static void run_table(const table_impl *impl, key_dist dist, size_t ntokens)
+{
+  key_set *ks = create_key_set(dist, ntokens);
+  double base = peak_rss(), insert, hit, miss, mixed, start;
+  size_t distinct = 0, i;
+  char *seen;
+  void *t;
+
+  seen = (char *) calloc(ks->nkeys, 1);
+  if (seen == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+
+  t = impl->create();
+  insert = run_workload(impl, t, ks, WORK_INSERT, ntokens, seen);
+  if (impl->finish != NULL) {
+    /* spread over the inserts, as a table built once would pay it */
+    start = bench_seconds();
+    impl->finish(t);
+    insert += (bench_seconds() - start) * 1e9 / ntokens;
+  }
+  hit = run_workload(impl, t, ks, WORK_HIT, ntokens, NULL);
+  miss = run_workload(impl, t, ks, WORK_MISS, ntokens, NULL);
+  for (i = 0; i < ks->nkeys; i++) {
+    distinct += seen[i];
+  }
+  printf("%-11s %9.1f %9.1f %9.1f", impl->name, insert, hit, miss);
+  if (impl->finish == NULL) {
+    mixed = run_workload(impl, t, ks, WORK_MIXED, ntokens, NULL);
+    printf(" %9.1f", mixed);
+  }
+  else {
+    printf(" %9s", "n/a");
+  }
+  printf(" %9.1f %9.1f %9.1f\n", (double) impl->bytes(t) / distinct,
+         peak_rss(), peak_rss() - base);
+
+  impl->destroy(t);
+  free(seen);
+  free_key_set(ks);
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t max_tokens = 1000000, ntokens, j;
+  int first = KEYS_ZIPF, last = KEYS_ADVERSARIAL, d, status;
+  pid_t pid;
+
+  if (argc > 1) {
+    max_tokens = (size_t) atof(argv[1]);
+  }
+  if (argc > 2) {
+    for (d = KEYS_ZIPF; d <= KEYS_ADVERSARIAL &&
+                        strcmp(argv[2], key_dist_name((key_dist) d)) != 0;
+         d++) {
+    }
+    first = last = d;
+  }
+  if (argc > 3 || max_tokens < 1000 || first > KEYS_ADVERSARIAL) {
+    fprintf(stderr, "usage: %s [max_tokens [zipf|uniform|adversarial]]\n",
+            argv[0]);
+    return 1;
+  }
+
+  for (d = first; d <= last; d++) {
+    for (ntokens = 1000; ntokens <= max_tokens; ntokens *= 10) {
+      if (d == KEYS_ADVERSARIAL && ntokens > ADVERSARIAL_MAX_TOKENS) {
+        break;
+      }
+      printf("%s: %lu tokens over %lu keys\n", key_dist_name((key_dist) d),
+             (unsigned long) ntokens,
+             (unsigned long) key_set_size((key_dist) d, ntokens));
+      printf("%-11s %9s %9s %9s %9s %9s %9s %9s\n", "table", "insert",
+             "hit", "miss", "mixed", "bytes/key", "peak MB", "table MB");
+
+      for (j = 0; j < bench_ntables; j++) {
+        fflush(stdout);
+        pid = fork();
+        if (pid < 0) {
+          perror("fork");
+          return 1;
+        }
+        if (pid == 0) {
+          run_table(&bench_tables[j], (key_dist) d, ntokens);
+          fflush(stdout);
+          _exit(0);
+        }
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+          fprintf(stderr, "%s failed!\n", bench_tables[j].name);
+          return 1;
+        }
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,284 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_tables.c
+ *
+ *       Adapters from each table's own interface to the one the
+ *       benchmarks use.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "bench_tables.h"
+#include "hash_table.h"
+#include "table_stats.h"
+#include "swiss_table.h"
+#include "frozen_table.h"
+#include "word_map.h"
+#include "concurrent_hash_table.h"
+#include "memcheck.h"
+
+HASH_MAP_FUNCTIONS(word_map, word_key, int, word_key_hash, word_key_equal)
+
+int bench_bloom_bits = 10;
+
+/* A frozen table and the hash table it is built from. */
+typedef struct
+{
+  hash_table *ht;
+  frozen_table *ft;
+} frozen_bench;
+
+
+/*** Adapters. ***/
+
+static void *chained_create(void)
+{
+  return create_hash_table();
+}
+
+static void *incremental_create(void)
+{
+  hash_table *ht = create_hash_table();
+  set_incremental_resize(ht, 1);
+  return ht;
+}
+
+static void *bloom_create(void)
+{
+  hash_table *ht = create_hash_table();
+  set_bloom_filter(ht, bench_bloom_bits);
+  return ht;
+}
+
+static void chained_destroy(void *t)
+{
+  free_hash_table((hash_table *) t);
+}
+
+static void chained_add(void *t, const char *key, size_t len)
+{
+  add_value((hash_table *) t, key, len, 1);
+}
+
+static int chained_get(void *t, const char *key, size_t len)
+{
+  return lookup_value((hash_table *) t, key, len);
+}
+
+static void chained_remove(void *t, const char *key, size_t len)
+{
+  if (add_value((hash_table *) t, key, len, -1) == 0) {
+    remove_key((hash_table *) t, key, len);
+  }
+}
+
+static size_t chained_bytes(void *t)
+{
+  return table_bytes((hash_table *) t);
+}
+
+static void *swiss_create(void)
+{
+  return create_swiss_table();
+}
+
+static void swiss_destroy(void *t)
+{
+  free_swiss_table((swiss_table *) t);
+}
+
+static void swiss_add(void *t, const char *key, size_t len)
+{
+  swiss_add_value((swiss_table *) t, key, len, 1);
+}
+
+static int swiss_get(void *t, const char *key, size_t len)
+{
+  return swiss_get_value((swiss_table *) t, key, len);
+}
+
+static void swiss_remove_one(void *t, const char *key, size_t len)
+{
+  if (swiss_add_value((swiss_table *) t, key, len, -1) == 0) {
+    swiss_remove((swiss_table *) t, key, len);
+  }
+}
+
+static size_t swiss_bytes(void *t)
+{
+  swiss_table *st = (swiss_table *) t;
+  size_t bytes = sizeof(swiss_table) +
+                 st->capacity * (1 + sizeof(swiss_entry)), i;
+
+  for (i = 0; i < st->capacity; i++) {
+    if (SWISS_FULL(st->ctrl[i])) {
+      bytes += st->entries[i].len + 1;
+    }
+  }
+  return bytes;
+}
+
+static void *frozen_create(void)
+{
+  frozen_bench *fb = (frozen_bench *) malloc(sizeof(frozen_bench));
+  if (fb == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  fb->ht = create_hash_table();
+  fb->ft = NULL;
+  return fb;
+}
+
+static void frozen_destroy(void *t)
+{
+  frozen_bench *fb = (frozen_bench *) t;
+  if (fb->ft != NULL) {
+    free_frozen_table(fb->ft);
+  }
+  else {
+    free_hash_table(fb->ht);  /* never finished */
+  }
+  free(fb);
+}
+
+static void frozen_add(void *t, const char *key, size_t len)
+{
+  add_value(((frozen_bench *) t)->ht, key, len, 1);
+}
+
+static void frozen_finish(void *t)
+{
+  frozen_bench *fb = (frozen_bench *) t;
+  fb->ft = freeze_hash_table(fb->ht);
+  if (fb->ft == NULL) {
+    fprintf(stderr, "frozen: no perfect hash found!\n");
+    exit(1);
+  }
+  free_hash_table(fb->ht);
+  fb->ht = NULL;
+}
+
+static int frozen_get(void *t, const char *key, size_t len)
+{
+  return frozen_get_value(((frozen_bench *) t)->ft, key, len);
+}
+
+static size_t frozen_bytes(void *t)
+{
+  return frozen_table_bytes(((frozen_bench *) t)->ft);
+}
+
+static void *map_create(void)
+{
+  return word_map_create();
+}
+
+static void map_destroy(void *t)
+{
+  word_map_free((word_map *) t);
+}
+
+static void map_add(void *t, const char *key, size_t len)
+{
+  word_key k;
+  int inserted;
+
+  k.s = key;
+  k.len = len;
+  k.hash = hash64(key, len);
+  (*word_map_put((word_map *) t, &k, &inserted))++;
+}
+
+static int map_get(void *t, const char *key, size_t len)
+{
+  word_key k;
+  int *v;
+
+  k.s = key;
+  k.len = len;
+  k.hash = hash64(key, len);
+  v = word_map_get((word_map *) t, &k);
+  return v != NULL ? *v : 0;
+}
+
+static void map_remove(void *t, const char *key, size_t len)
+{
+  word_key k;
+  int *v;
+
+  k.s = key;
+  k.len = len;
+  k.hash = hash64(key, len);
+  v = word_map_get((word_map *) t, &k);
+  if (v != NULL && --*v == 0) {
+    word_map_remove((word_map *) t, &k);
+  }
+}
+
+static size_t map_bytes(void *t)
+{
+  word_map *wm = (word_map *) t;
+  return sizeof(word_map) + wm->capacity * (1 + sizeof(word_map_entry));
+}
+
+static void *concurrent_create(void)
+{
+  return create_concurrent_hash_table(0);
+}
+
+static void concurrent_destroy(void *t)
+{
+  free_concurrent_hash_table((concurrent_hash_table *) t);
+}
+
+static void concurrent_add(void *t, const char *key, size_t len)
+{
+  chash_add((concurrent_hash_table *) t, key, len, 1);
+}
+
+static int concurrent_get(void *t, const char *key, size_t len)
+{
+  return (int) chash_get((concurrent_hash_table *) t, key, len);
+}
+
+static size_t concurrent_bytes(void *t)
+{
+  concurrent_hash_table *cht = (concurrent_hash_table *) t;
+  chash_array *a = cht->current, *old;
+  size_t bytes = sizeof(concurrent_hash_table), i;
+
+  /* arrays left over from resizing are kept until the table is freed */
+  for (old = a; old != NULL; old = old->retired) {
+    bytes += sizeof(chash_array) + old->size * sizeof(chash_slot);
+  }
+  for (i = 0; i < a->size; i++) {
+    if ((size_t) a->slots[i].key > 1) {  /* neither empty nor moved */
+      bytes += offsetof(chash_key, key) + a->slots[i].key->len + 1;
+    }
+  }
+  return bytes;
+}
+
+const table_impl bench_tables[] = {
+  { "chained", chained_create, chained_destroy, chained_add, NULL,
+    chained_get, chained_remove, chained_bytes },
+  { "chain-incr", incremental_create, chained_destroy, chained_add, NULL,
+    chained_get, chained_remove, chained_bytes },
+  { "chain-bloom", bloom_create, chained_destroy, chained_add, NULL,
+    chained_get, chained_remove, chained_bytes },
+  { "swiss", swiss_create, swiss_destroy, swiss_add, NULL, swiss_get,
+    swiss_remove_one, swiss_bytes },
+  { "frozen", frozen_create, frozen_destroy, frozen_add, frozen_finish,
+    frozen_get, NULL, frozen_bytes },
+  { "map", map_create, map_destroy, map_add, NULL, map_get, map_remove,
+    map_bytes },
+  { "concurrent", concurrent_create, concurrent_destroy, concurrent_add, NULL,
+    concurrent_get, NULL, concurrent_bytes }
+};
+
+const size_t bench_ntables = sizeof(bench_tables) / sizeof(bench_tables[0]);
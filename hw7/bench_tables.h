@@ -0,0 +1,45 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_tables.h
+ *
+ *       Every table implementation behind one interface, for the
+ *       benchmarks.  Keys are zero-terminated and passed with their
+ *       length.  The generic map keeps pointers to them rather than
+ *       copies, so keys must outlive the table.
+ *
+ */
+
+#ifndef BENCH_TABLES_H
+#define BENCH_TABLES_H
+
+#include <stddef.h>
+
+/*
+ * One table implementation.  'add' adds 1 to a key's value, inserting
+ * the key if needed.  'finish', if not NULL, is called once all keys
+ * are added and before any lookup; after it the table is read-only.
+ * 'remove', if not NULL, undoes one 'add': it takes 1 off a key that is
+ * in the table, and removes the key once its value reaches 0.  'bytes'
+ * is the memory the table uses, not counting malloc's own overhead.
+ */
+
+typedef struct
+{
+    const char *name;
+    void *(*create)(void);
+    void (*destroy)(void *t);
+    void (*add)(void *t, const char *key, size_t len);
+    void (*finish)(void *t);
+    int (*get)(void *t, const char *key, size_t len);
+    void (*remove)(void *t, const char *key, size_t len);
+    size_t (*bytes)(void *t);
+} table_impl;
+
+extern const table_impl bench_tables[];
+extern const size_t bench_ntables;
+
+/* Bits per key of the "chain-bloom" table's filter (default 10). */
+extern int bench_bloom_bits;
+
+#endif  /* BENCH_TABLES_H */
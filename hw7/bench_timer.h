@@ -0,0 +1,16 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_timer.h
+ *
+ *       The clock the benchmarks and stress tests time themselves by.
+ *
+ */
+
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+/* Return the time on a monotonic clock, in seconds. */
+double bench_seconds(void);
+
+#endif  /* BENCH_TIMER_H */
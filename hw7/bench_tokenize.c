@@ -0,0 +1,202 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_tokenize.c
+ *
+ *       Throughput of the tokenizers: the whitespace tokenizer, the
+ *       folding tokenizer, and a plain byte-at-a-time loop with
+ *       isalnum() and tolower() for reference.  Two generated inputs are
+ *       used, one of English-like ASCII text with capitals and
+ *       punctuation, and one mixing Latin-1, Greek and Cyrillic words.
+ *       The folding tokenizer rewrites its input, so every run gets a
+ *       fresh copy (made outside the timing).
+ *
+ *       usage: bench_tokenize [megabytes [repeats]]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "tokenizer.h"
+#include "bench_timer.h"
+#include "memcheck.h"
+
+/* What a tokenizer found, to check the runs against each other. */
+typedef struct
+{
+  size_t nwords;
+  size_t nbytes;
+  unsigned long sum;  /* sum of the first byte of every word */
+} token_totals;
+
+static const char *ascii_words[] = {
+  "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as",
+  "was", "with", "be", "by", "on", "not", "he", "this", "are", "or",
+  "his", "from", "at", "which", "but", "have", "an", "had", "they",
+  "table", "hash", "counting", "thread", "words", "memory", "2024"
+};
+
+static const char *utf8_words[] = {
+  "caf\xc3\xa9", "\xc3\x89t\xc3\xa9", "na\xc3\xafve", "\xc3\x80 la",
+  "Stra\xc3\x9f" "e", "\xc5\x81\xc3\xb3" "d\xc5\xba",
+  "\xc5\xbb\xc3\xb3\xc5\x82w",
+  "\xce\x91\xce\xb8\xce\xae\xce\xbd\xce\xb1",
+  "\xce\xbb\xcf\x8c\xce\xb3\xce\xbf\xcf\x82",
+  "\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0",
+  "\xd1\x81\xd0\xbb\xd0\xbe\xd0\xb2\xd0\xbe",
+  "\xd0\x81\xd0\xbb\xd0\xba\xd0\xb0",
+  "\xe2\x80\x9cquoted\xe2\x80\x9d", "word", "the", "and"
+};
+
+static const char *separators[] = {
+  " ", " ", " ", " ", " ", ", ", ". ", "\n", "; ", " (", ") ", "-", "'"
+};
+
+#define NELEMS(a) (sizeof(a) / sizeof((a)[0]))
+
+
+/* make_text: generate 'size' bytes of words and separators.
+ * arguments: size: number of bytes
+ *            words, nwords: the vocabulary
+ * return: new buffer of exactly 'size' bytes
+ */
+static char *make_text(size_t size, const char **words, size_t nwords)
+{
+  char *text = (char *) malloc(size + 64), *p = text, *end = text + size;
+  const char *w;
+  unsigned long r = 12345;
+  size_t len;
+
+  if (text == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  while (p < end) {
+    r = r * 6364136223846793005UL + 1442695040888963407UL;
+    w = words[(r >> 33) % nwords];
+    len = strlen(w);
+    memcpy(p, w, len);
+    if ((r >> 20) % 8 == 0 && *p >= 'a' && *p <= 'z') {
+      *p += 'A' - 'a';  /* a capital now and then */
+    }
+    p += len;
+    w = separators[(r >> 40) % NELEMS(separators)];
+    len = strlen(w);
+    memcpy(p, w, len);
+    p += len;
+  }
+  return text;
+}
+
+
+/* add_token: token callback that adds a word to the totals. */
+static void add_token(const char *word, size_t len, void *arg)
+{
+  token_totals *t = (token_totals *) arg;
+  t->nwords++;
+  t->nbytes += len;
+  t->sum += (unsigned char) word[0];
+}
+
+
+/* tokenize_naive: ASCII-only folding tokenizer, one byte at a time.
+ * arguments: as for tokenize_folded(); bytes >= 0x80 count as letters
+ * return: number of words found
+ */
+static size_t tokenize_naive(char *data, size_t size, token_fn fn, void *arg)
+{
+  size_t i = 0, start, nwords = 0;
+
+  while (i < size) {
+    while (i < size && !isalnum((unsigned char) data[i]) &&
+           !(data[i] & 0x80)) {
+      i++;
+    }
+    if (i == size) {
+      break;
+    }
+    start = i;
+    while (i < size && (isalnum((unsigned char) data[i]) ||
+                        (data[i] & 0x80))) {
+      data[i] = (char) tolower((unsigned char) data[i]);
+      i++;
+    }
+    fn(data + start, i - start, arg);
+    nwords++;
+  }
+  return nwords;
+}
+
+
+/* run: time one tokenizer over a text.
+ * arguments: name: label for the report
+ *            mode: -1 for the naive loop, otherwise a word_mode
+ *            text, size: the input (left unchanged)
+ *            copy: scratch buffer of 'size' bytes
+ *            repeats: number of runs; the fastest is reported
+ */
+static void run(const char *name, int mode, const char *text, size_t size,
+                char *copy, int repeats)
+{
+  token_totals t;
+  double start, best = 0;
+  int i;
+
+  for (i = 0; i < repeats; i++) {
+    memcpy(copy, text, size);
+    memset(&t, 0, sizeof(t));
+    start = bench_seconds();
+    if (mode < 0) {
+      tokenize_naive(copy, size, add_token, &t);
+    }
+    else {
+      tokenize_words(copy, size, (word_mode) mode, add_token, &t);
+    }
+    start = bench_seconds() - start;
+    if (i == 0 || start < best) {
+      best = start;
+    }
+  }
+  printf("  %-8s %8.0f MB/s  %9lu words  %10lu word bytes  sum %lu\n",
+         name, size / best / 1e6, (unsigned long) t.nwords,
+         (unsigned long) t.nbytes, t.sum);
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t size = (size_t) (argc > 1 ? atof(argv[1]) : 64) * 1000000;
+  int repeats = argc > 2 ? atoi(argv[2]) : 5;
+  char *ascii, *utf8, *copy;
+
+  if (size == 0 || repeats <= 0) {
+    fprintf(stderr, "usage: %s [megabytes [repeats]]\n", argv[0]);
+    return 1;
+  }
+  ascii = make_text(size, ascii_words, NELEMS(ascii_words));
+  utf8 = make_text(size, utf8_words, NELEMS(utf8_words));
+  copy = (char *) malloc(size);
+  if (copy == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+
+  printf("ASCII text, %lu bytes:\n", (unsigned long) size);
+  run("plain", WORDS_PLAIN, ascii, size, copy, repeats);
+  run("folded", WORDS_FOLDED, ascii, size, copy, repeats);
+  run("naive", -1, ascii, size, copy, repeats);
+
+  printf("UTF-8 text, %lu bytes:\n", (unsigned long) size);
+  run("plain", WORDS_PLAIN, utf8, size, copy, repeats);
+  run("folded", WORDS_FOLDED, utf8, size, copy, repeats);
+  run("naive", -1, utf8, size, copy, repeats);
+
+  free(ascii);
+  free(utf8);
+  free(copy);
+  return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench_window.c
+ *
+ *       Sliding-window counting benchmark.  A stream of random words
+ *       (drawn from 'vocab' distinct words) is counted over the last
+ *       'window' words: each step adds one to the newest word and takes
+ *       one off the word leaving the window, removing it when its count
+ *       reaches zero.  The steps are timed in phases, and the table's
+ *       size after each phase shows that deletes keep it from growing
+ *       without bound.  Draining the window at the end must leave no
+ *       word counted.  Tables that can't remove keys are skipped.
+ *
+ *       usage: bench_window [window [vocab [steps_per_phase]]]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench_tables.h"
+#include "bench_timer.h"
+#include "key_gen.h"
+#include "memcheck.h"
+
+/* Longest generated key, including the zero byte. */
+#define KEY_SIZE 24
+
+/* Number of timed phases. */
+#define NPHASES 5
+
+
+int main(int argc, char **argv)
+{
+  long window = 100000, vocab = 1000000, steps = 1000000, i, phase;
+  char (*words)[KEY_SIZE];
+  size_t *len;
+  long *ring, oldest, in, out;
+  unsigned long state;
+  double start;
+  const table_impl *impl;
+  size_t j;
+  void *t;
+
+  if (argc > 1) {
+    window = atol(argv[1]);
+  }
+  if (argc > 2) {
+    vocab = atol(argv[2]);
+  }
+  if (argc > 3) {
+    steps = atol(argv[3]);
+  }
+  if (argc > 4 || window < 1 || vocab < 1 || steps < 1) {
+    fprintf(stderr, "usage: %s [window [vocab [steps_per_phase]]]\n",
+            argv[0]);
+    return 1;
+  }
+
+  words = (char (*)[KEY_SIZE]) malloc(vocab * KEY_SIZE);
+  len = (size_t *) malloc(vocab * sizeof(size_t));
+  ring = (long *) malloc(window * sizeof(long));
+  if (words == NULL || len == NULL || ring == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    return 1;
+  }
+  for (i = 0; i < vocab; i++) {
+    sprintf(words[i], "word%ld", i);
+    len[i] = strlen(words[i]);
+  }
+
+  printf("window %ld, %ld distinct words, %ld steps per phase\n", window,
+         vocab, steps);
+  printf("%-11s %6s %10s %10s\n", "table", "phase", "ns/step",
+         "table MB");
+  for (j = 0; j < bench_ntables; j++) {
+    impl = &bench_tables[j];
+    if (impl->remove == NULL || impl->finish != NULL) {
+      continue;
+    }
+    t = impl->create();
+    state = 42;
+    oldest = 0;   /* the ring's slot of the word to leave next */
+
+    /* fill the first window */
+    for (i = 0; i < window; i++) {
+      ring[i] = (long) (key_random(&state) % vocab);
+      impl->add(t, words[ring[i]], len[ring[i]]);
+    }
+
+    for (phase = 1; phase <= NPHASES; phase++) {
+      start = bench_seconds();
+      for (i = 0; i < steps; i++) {
+        in = (long) (key_random(&state) % vocab);
+        out = ring[oldest];
+        ring[oldest] = in;
+        if (++oldest == window) {
+          oldest = 0;
+        }
+        impl->add(t, words[in], len[in]);
+        impl->remove(t, words[out], len[out]);
+      }
+      printf("%-11s %6ld %10.1f %10.1f\n", impl->name, phase,
+             (bench_seconds() - start) * 1e9 / steps,
+             impl->bytes(t) / 1e6);
+    }
+
+    for (i = 0; i < window; i++) {
+      impl->remove(t, words[ring[i]], len[ring[i]]);
+    }
+    for (i = 0; i < vocab; i++) {
+      if (impl->get(t, words[i], len[i]) != 0) {
+        fprintf(stderr, "%s: %s still counted after draining the window!\n",
+                impl->name, words[i]);
+        return 1;
+      }
+    }
+    impl->destroy(t);
+  }
+
+  free(words);
+  free(len);
+  free(ring);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bloom_filter.c
+ *
+ *       Implementation of the blocked Bloom filter.
+ *
+ *       The key hash is mixed first (FNV bits are too regular to use as
+ *       they are).  The high half of the mixed hash picks the block and
+ *       the low half generates the bit positions inside it by double
+ *       hashing: bit i is (a + i * b) mod 512.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bloom_filter.h"
+#include "hash_table.h"
+#include "memcheck.h"
+
+/* Most bits set per key. */
+#define MAX_PROBES 16
+
+
+/* create_bloom_filter: create an empty filter.
+ * arguments: capacity: number of keys to size the filter for
+ *            bits_per_key: bits of filter per key (at least 1)
+ * return: pointer to the filter
+ */
+bloom_filter *create_bloom_filter(size_t capacity, int bits_per_key)
+{
+  bloom_filter *bf;
+  size_t bytes;
+
+  bf = (bloom_filter *) malloc(sizeof(bloom_filter));
+  if (bf == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  bf->capacity = capacity;
+  bf->nadded = 0;
+  bf->bits_per_key = bits_per_key;
+  bf->nblocks = (capacity * bits_per_key + BLOOM_BLOCK_BITS - 1) /
+                BLOOM_BLOCK_BITS + 1;
+
+  /* k = bits_per_key * ln 2 minimizes the false-positive rate */
+  bf->nprobes = (bits_per_key * 69 + 50) / 100;
+  if (bf->nprobes < 1) {
+    bf->nprobes = 1;
+  }
+  if (bf->nprobes > MAX_PROBES) {
+    bf->nprobes = MAX_PROBES;
+  }
+
+  /* blocks start on a cache-line boundary */
+  bytes = bf->nblocks * BLOOM_BLOCK_BITS / 8;
+  bf->mem = malloc(bytes + 63);
+  if (bf->mem == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  bf->blocks = (uint64_t *) (((size_t) bf->mem + 63) & ~(size_t) 63);
+  memset(bf->blocks, 0, bytes);
+  return bf;
+}
+
+
+/* free_bloom_filter: free a filter.
+ * arguments: bf: pointer to the filter to be freed
+ */
+void free_bloom_filter(bloom_filter *bf)
+{
+  free(bf->mem);
+  free(bf);
+}
+
+
+/* bloom_add: record a key.
+ * arguments: bf: the filter
+ *            hash: hash64() of the key
+ */
+void bloom_add(bloom_filter *bf, uint64_t hash)
+{
+  uint64_t m = mix64(hash), *block;
+  uint32_t a = (uint32_t) m, b = (a >> 17 | a << 15) | 1;
+  int i;
+
+  bf->nadded++;
+  block = bf->blocks + ((m >> 32) * bf->nblocks >> 32) * BLOOM_BLOCK_WORDS;
+  for (i = 0; i < bf->nprobes; i++, a += b) {
+    block[(a % BLOOM_BLOCK_BITS) / 64] |= (uint64_t) 1 << (a % 64);
+  }
+}
+
+
+/* bloom_may_contain: test for a key.
+ * arguments: bf: the filter
+ *            hash: hash64() of the key
+ * return: 0 if the key was certainly never added, 1 otherwise
+ */
+int bloom_may_contain(const bloom_filter *bf, uint64_t hash)
+{
+  uint64_t m = mix64(hash);
+  const uint64_t *block;
+  uint32_t a = (uint32_t) m, b = (a >> 17 | a << 15) | 1;
+  int i;
+
+  block = bf->blocks + ((m >> 32) * bf->nblocks >> 32) * BLOOM_BLOCK_WORDS;
+  for (i = 0; i < bf->nprobes; i++, a += b) {
+    if (!(block[(a % BLOOM_BLOCK_BITS) / 64] & (uint64_t) 1 << (a % 64))) {
+      return 0;
+    }
+  }
+  return 1;
+}
@@ -0,0 +1,53 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bloom_filter.h
+ *
+ *       A blocked Bloom filter over 64-bit key hashes.  Each key sets a
+ *       few bits inside a single 512-bit block (one cache line), so
+ *       adding or testing a key touches one line of memory.  A "no" from
+ *       the filter is always right; a "maybe" is wrong for a small,
+ *       tunable fraction of absent keys.
+ *
+ */
+
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bits per block, and 64-bit words per block. */
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_BLOCK_WORDS (BLOOM_BLOCK_BITS / 64)
+
+typedef struct _bloom_filter
+{
+    uint64_t *blocks;     /* nblocks * BLOOM_BLOCK_WORDS words */
+    size_t    nblocks;
+    size_t    capacity;   /* number of keys the filter was sized for */
+    size_t    nadded;     /* number of bloom_add() calls so far */
+    int       bits_per_key;
+    int       nprobes;    /* bits set per key */
+    void     *mem;        /* allocation 'blocks' is aligned within */
+} bloom_filter;
+
+
+/*
+ * Create an empty filter using about 'bits_per_key' bits for each of
+ * 'capacity' keys.
+ */
+bloom_filter *create_bloom_filter(size_t capacity, int bits_per_key);
+
+void free_bloom_filter(bloom_filter *bf);
+
+/* Record a key by its hash. */
+void bloom_add(bloom_filter *bf, uint64_t hash);
+
+/*
+ * Return 0 if no key with this hash was added, and 1 if one may have
+ * been.
+ */
+int bloom_may_contain(const bloom_filter *bf, uint64_t hash);
+
+#endif  /* BLOOM_FILTER_H */
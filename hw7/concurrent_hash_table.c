@@ -0,0 +1,363 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: concurrent_hash_table.c
+ *
+ *       Implementation of the concurrent hash table.
+ *
+ *       The table is open-addressed with linear probing.  All shared
+ *       fields are read and written with the GCC __atomic builtins.
+ *
+ *       Resizing: the first thread to find the array too full allocates
+ *       an array twice the size and publishes it in 'next'.  From then
+ *       on every thread that touches the old array helps copy it, a
+ *       chunk of slots at a time.  Copying a slot either marks an empty
+ *       slot MOVED (so nothing can be inserted there any more) or sets
+ *       the FROZEN bit in its value and adds the frozen value into the
+ *       new array.  A thread whose increment lands on a frozen value
+ *       simply redoes it in the new array, so no update is lost.  Once
+ *       all slots are copied the new array becomes current.  Old arrays
+ *       can still be read by slow threads, so they are only freed along
+ *       with the table.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <sched.h>
+#include "concurrent_hash_table.h"
+#include "hash_table.h"
+#include "memcheck.h"
+
+/* Smallest slot array. */
+#define MIN_SIZE 16
+
+/* Number of slots a migrating thread copies at a time. */
+#define MIGRATE_CHUNK 256
+
+/* Marker for a slot that was empty when its array was migrated. */
+#define MOVED ((chash_key *) 1)
+
+/*
+ * Values are stored doubled, which leaves the low bit for FROZEN, set
+ * once a slot has been copied to the next array.  Adding a doubled delta
+ * can't carry into that bit or borrow from it, whatever the signs.
+ */
+#define FROZEN 1L
+#define STORED(v)  ((v) * 2)
+#define VALUE(s)   (((s) & ~FROZEN) / 2)
+
+#define load(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define fetch_add(p, v)  __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define cas(p, expected, desired) \
+  __atomic_compare_exchange_n((p), (expected), (desired), 0, \
+                              __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)
+
+
+/*** Keys and arrays. ***/
+
+/* create_key: make a key record holding a copy of the characters.
+ * arguments: key, len: the characters
+ *            hash: hash of the characters
+ * return: pointer to the new key
+ */
+static chash_key *create_key(const char *key, size_t len, uint64_t hash)
+{
+  chash_key *k;
+  k = (chash_key *) malloc(offsetof(chash_key, key) + len + 1);
+  if (k == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  k->hash = hash;
+  k->len = len;
+  memcpy(k->key, key, len);
+  k->key[len] = '\0';
+  return k;
+}
+
+
+/* create_array: make an empty slot array.
+ * arguments: size: number of slots (a power of two)
+ * return: pointer to the new array
+ */
+static chash_array *create_array(size_t size)
+{
+  chash_array *a;
+  a = (chash_array *) calloc(1, sizeof(chash_array));
+  if (a == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  a->size = size;
+  a->slots = (chash_slot *) calloc(size, sizeof(chash_slot));
+  if (a->slots == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  return a;
+}
+
+
+/* key_matches: check a published key against a key being looked up. */
+static int key_matches(const chash_key *k, const char *key, size_t len,
+                       uint64_t hash)
+{
+  return k->hash == hash && k->len == len && memcmp(k->key, key, len) == 0;
+}
+
+
+/*** Resizing. ***/
+
+/* start_resize: make sure a larger array is being migrated into.
+ * arguments: a: the array that is too full
+ */
+static void start_resize(chash_array *a)
+{
+  chash_array *b, *expected = NULL;
+
+  if (load(&a->next) != NULL) {
+    return;
+  }
+  b = create_array(a->size * 2);
+  if (!cas(&a->next, &expected, b)) { /* another thread won */
+    free(b->slots);
+    free(b);
+  }
+}
+
+
+/* place_key: put a key moved out of an older array into 'b'.  Only
+ * migrating threads write to 'b' until it is promoted, and each key is
+ * moved exactly once, so the key can't already be there.
+ * arguments: b: array being migrated into
+ *            k: key record to move
+ *            value: value the key had in the older array
+ */
+static void place_key(chash_array *b, chash_key *k, long value)
+{
+  size_t mask = b->size - 1, i;
+  chash_key *expected;
+
+  for (i = k->hash & mask; ; i = (i + 1) & mask) {
+    expected = NULL;
+    if (cas(&b->slots[i].key, &expected, k)) {
+      fetch_add(&b->slots[i].value, value);
+      fetch_add(&b->count, 1);
+      return;
+    }
+  }
+}
+
+
+/* migrate_slot: copy one slot of 'a' into 'a->next'.
+ * arguments: a: array being migrated
+ *            i: index of the slot
+ */
+static void migrate_slot(chash_array *a, size_t i)
+{
+  chash_slot *s = &a->slots[i];
+  chash_key *k = NULL;
+  long v;
+
+  /* an empty slot is closed off so no key can be inserted later */
+  if (cas(&s->key, &k, MOVED)) {
+    return;
+  }
+  v = __atomic_fetch_or(&s->value, FROZEN, __ATOMIC_SEQ_CST);
+  place_key(load(&a->next), k, v & ~FROZEN);
+}
+
+
+/* help_resize: help copy 'a' into its next array, wait for the copy to
+ *              finish and make the next array current.
+ * arguments: cht: the table
+ *            a: array being migrated
+ */
+static void help_resize(concurrent_hash_table *cht, chash_array *a)
+{
+  size_t start, end, i;
+  chash_array *expected = a;
+
+  if (load(&a->next) == NULL) { /* not being resized */
+    return;
+  }
+  while ((start = fetch_add(&a->claimed, MIGRATE_CHUNK)) < a->size) {
+    end = start + MIGRATE_CHUNK < a->size ? start + MIGRATE_CHUNK : a->size;
+    for (i = start; i < end; i++) {
+      migrate_slot(a, i);
+    }
+    fetch_add(&a->migrated, end - start);
+  }
+
+  /* other threads may still be copying the chunks they claimed */
+  while (load(&a->migrated) < a->size) {
+    sched_yield();
+  }
+  if (cas(&cht->current, &expected, a->next)) {
+    a->next->retired = a;
+  }
+}
+
+
+/*** Table operations. ***/
+
+/* create_concurrent_hash_table: create an empty table.
+ * arguments: size_hint: number of keys to leave room for
+ * return: pointer to the new table
+ */
+concurrent_hash_table *create_concurrent_hash_table(size_t size_hint)
+{
+  concurrent_hash_table *cht;
+  size_t size = MIN_SIZE;
+
+  while (size / 4 * 3 < size_hint) {
+    size *= 2;
+  }
+  cht = (concurrent_hash_table *) malloc(sizeof(concurrent_hash_table));
+  if (cht == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  cht->current = create_array(size);
+  return cht;
+}
+
+
+/* free_concurrent_hash_table: free a table, its arrays and its keys.
+ * arguments: cht: pointer to the table to be freed
+ */
+void free_concurrent_hash_table(concurrent_hash_table *cht)
+{
+  chash_array *a, *older;
+  size_t i;
+
+  a = cht->current;
+  /* every key lives in the current array (older ones only alias them) */
+  for (i = 0; i < a->size; i++) {
+    if (a->slots[i].key != NULL && a->slots[i].key != MOVED) {
+      free(a->slots[i].key);
+    }
+  }
+  for (; a != NULL; a = older) {
+    older = a->retired;
+    free(a->slots);
+    free(a);
+  }
+  free(cht);
+}
+
+
+/* chash_get: look up a key without taking any locks.
+ * arguments: cht: the table
+ *            key, len: the key
+ * return: the value at the key, or 0 if the key isn't in the table
+ */
+long chash_get(concurrent_hash_table *cht, const char *key, size_t len)
+{
+  uint64_t hash = hash64(key, len);
+  chash_array *a;
+  chash_key *k;
+  size_t mask, i, n;
+  long v;
+
+retry:
+  a = load(&cht->current);
+  mask = a->size - 1;
+  for (i = hash & mask, n = 0; n < a->size; i = (i + 1) & mask, n++) {
+    k = load(&a->slots[i].key);
+    if (k == NULL) {
+      return 0;
+    }
+    if (k == MOVED) {
+      help_resize(cht, a);
+      goto retry;
+    }
+    if (key_matches(k, key, len, hash)) {
+      v = load(&a->slots[i].value);
+      if (v & FROZEN) { /* the current value is in the next array */
+        help_resize(cht, a);
+        goto retry;
+      }
+      return VALUE(v);
+    }
+  }
+  return 0;
+}
+
+
+/* chash_add: add to the value at a key, inserting the key if needed.
+ * arguments: cht: the table
+ *            key, len: the key
+ *            delta: amount to add
+ * return: the value right after this update
+ */
+long chash_add(concurrent_hash_table *cht, const char *key, size_t len,
+               long delta)
+{
+  uint64_t hash = hash64(key, len);
+  chash_key *fresh = NULL, *k;
+  chash_array *a;
+  size_t mask, i, n;
+  long v;
+
+retry:
+  a = load(&cht->current);
+  mask = a->size - 1;
+  for (i = hash & mask, n = 0; n < a->size; i = (i + 1) & mask, n++) {
+    k = load(&a->slots[i].key);
+
+    if (k == NULL) {
+      /* nothing new goes into an array that is too full or moving */
+      if (load(&a->next) != NULL || load(&a->count) + 1 > a->size / 4 * 3) {
+        start_resize(a);
+        help_resize(cht, a);
+        goto retry;
+      }
+      if (fresh == NULL) {
+        fresh = create_key(key, len, hash);
+      }
+      if (cas(&a->slots[i].key, &k, fresh)) {
+        fetch_add(&a->count, 1);
+        k = fresh;
+        fresh = NULL;
+      }
+      /* on failure 'k' now holds whatever another thread put there */
+    }
+
+    if (k == MOVED) {
+      help_resize(cht, a);
+      goto retry;
+    }
+    if (key_matches(k, key, len, hash)) {
+      v = fetch_add(&a->slots[i].value, STORED(delta));
+      if (v & FROZEN) { /* the slot was copied before this update */
+        help_resize(cht, a);
+        goto retry;
+      }
+      if (fresh != NULL) {
+        free(fresh);
+      }
+      return VALUE(v) + delta;
+    }
+  }
+
+  /* every slot was probed: grow the table */
+  start_resize(a);
+  help_resize(cht, a);
+  goto retry;
+}
+
+
+/* chash_count: number of keys in the table.
+ * arguments: cht: the table
+ * return: the number of keys
+ */
+size_t chash_count(concurrent_hash_table *cht)
+{
+  return load(&load(&cht->current)->count);
+}
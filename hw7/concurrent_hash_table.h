@@ -0,0 +1,98 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: concurrent_hash_table.h
+ *
+ *       A hash table that many threads can update at once.  Lookups take
+ *       no locks, values are incremented atomically in place, new keys
+ *       are inserted with compare-and-swap, and a full table is resized
+ *       cooperatively by every thread that runs into it.
+ *
+ */
+
+#ifndef CONCURRENT_HASH_TABLE_H
+#define CONCURRENT_HASH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A key.  Once a key has been published in a slot it is never changed,
+ * so readers can use it without synchronization.  When the table grows
+ * the same key record is moved to the new slot array.
+ */
+
+typedef struct
+{
+    uint64_t hash;  /* full hash of the key */
+    size_t   len;   /* number of characters in the key */
+    char     key[1];  /* 'len' characters and a zero byte */
+} chash_key;
+
+/*
+ * A slot: an empty slot has a NULL key.  The key goes from NULL to a
+ * chash_key exactly once; during a resize it may instead go from NULL to
+ * a "moved" marker.  'value' holds the value doubled, with its low bit
+ * reserved (see concurrent_hash_table.c).
+ */
+
+typedef struct
+{
+    chash_key *key;
+    long       value;
+} chash_slot;
+
+/*
+ * One slot array.  While the table is being resized, 'next' points to
+ * the larger array the slots are being copied into.
+ */
+
+typedef struct _chash_array
+{
+    size_t      size;          /* number of slots (a power of two) */
+    size_t      count;         /* number of slots holding keys */
+    chash_slot *slots;
+    struct _chash_array *next;  /* array being resized into, or NULL */
+    size_t      claimed;       /* slots handed out to migrating threads */
+    size_t      migrated;      /* slots finished by migrating threads */
+    struct _chash_array *retired;  /* older arrays, freed with the table */
+} chash_array;
+
+typedef struct
+{
+    chash_array *current;
+} concurrent_hash_table;
+
+
+/*
+ * Create an empty table with room for about 'size_hint' keys before its
+ * first resize.
+ */
+concurrent_hash_table *create_concurrent_hash_table(size_t size_hint);
+
+/*
+ * Free a table and all its keys.  No other thread may be using the
+ * table.
+ */
+void free_concurrent_hash_table(concurrent_hash_table *cht);
+
+/*
+ * Look up the 'len'-byte key at 'key'.  Return its value, or 0 if it
+ * is not in the table.  Safe to call from any thread at any time.
+ */
+long chash_get(concurrent_hash_table *cht, const char *key, size_t len);
+
+/*
+ * Add 'delta' to the value stored at the 'len'-byte key at 'key',
+ * inserting the key (with a private copy of its characters) if it isn't
+ * in the table yet.  Return the value just after this thread's update.
+ * 'delta' may be negative, but values must stay within half the range
+ * of a long.  Safe to call from any thread at any time.
+ */
+long chash_add(concurrent_hash_table *cht, const char *key, size_t len,
+               long delta);
+
+/* Return the number of keys in the table. */
+size_t chash_count(concurrent_hash_table *cht);
+
+#endif  /* CONCURRENT_HASH_TABLE_H */
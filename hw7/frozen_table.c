@@ -0,0 +1,303 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: frozen_table.c
+ *
+ *       Implementation of the frozen table, using "hash and displace":
+ *
+ *       Keys are spread over about n / 4 buckets by their hash.  Buckets
+ *       are then placed largest first.  A key's slot is a mix of its hash
+ *       and its bucket's displacement d, so trying d = 0, 1, 2, ... moves
+ *       the keys of a bucket to new, independent slots until all of them
+ *       land on free ones.  Large buckets go first while most slots are
+ *       still free; the small ones that are left fit easily even when the
+ *       array is nearly full.  The result uses 4 bytes of displacement
+ *       per bucket, about 1 byte per key, on top of the entries.
+ *
+ *       The cached hash of every node is reused, so freezing never
+ *       rehashes a key.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frozen_table.h"
+#include "memcheck.h"
+
+/* Average number of keys per bucket. */
+#define BUCKET_SIZE 4
+
+/* Displacements tried for one bucket before giving up. */
+#define MAX_DISP (1UL << 20)
+
+/* A key while the table is being built. */
+typedef struct
+{
+  uint64_t hash;
+  uint32_t len;
+  uint32_t key_off;
+  int value;
+} frozen_key;
+
+/* State threaded through for_each_node() while collecting keys. */
+typedef struct
+{
+  frozen_key *keys;
+  size_t n;
+  char *text;
+  size_t text_size;
+} collector;
+
+
+/*** Hashing. ***/
+
+/* reduce: map 32 random bits onto 0 .. n-1 without a division. */
+static size_t reduce(uint32_t x, size_t n)
+{
+  return (size_t) (((uint64_t) x * n) >> 32);
+}
+
+
+/* bucket_of, slot_of: where a key goes.  The raw FNV bits vary too
+ * little between similar keys to be used directly, so the bucket and
+ * (with d = 0) the slot take the low and high halves of the mixed hash.
+ */
+static size_t bucket_of(uint64_t hash, size_t nbuckets)
+{
+  return reduce((uint32_t) mix64(hash), nbuckets);
+}
+
+
+static size_t slot_of(uint64_t hash, uint32_t disp, size_t n)
+{
+  uint64_t m = mix64(hash ^ (disp * 0x9E3779B97F4A7C15UL));
+  return reduce((uint32_t) (m >> 32), n);
+}
+
+
+/*** Building. ***/
+
+/* collect_key: copy one node into the collector (for_each_node callback).
+ */
+static void collect_key(node *n, void *arg)
+{
+  collector *c = (collector *) arg;
+  frozen_key *k = &c->keys[c->n++];
+
+  k->hash = n->hash;
+  k->len = (uint32_t) n->len;
+  k->key_off = (uint32_t) c->text_size;
+  k->value = n->value;
+  memcpy(c->text + c->text_size, n->key, n->len + 1);
+  c->text_size += n->len + 1;
+}
+
+
+/* sum_key_size: add up the space the keys need (for_each_node callback).
+ */
+static void sum_key_size(node *n, void *arg)
+{
+  *(size_t *) arg += n->len + 1;
+}
+
+
+/* place_buckets: find a displacement for every bucket.
+ * arguments: ft: table whose 'disp' and 'entries' to fill in
+ *            keys: the keys, grouped by bucket
+ *            start: keys of bucket b are keys[start[b]] .. keys[start[b+1]-1]
+ * return: 0 on success, -1 if some bucket could not be placed
+ */
+static int place_buckets(frozen_table *ft, const frozen_key *keys,
+                         const size_t *start)
+{
+  size_t nb = ft->nbuckets, n = ft->count;
+  size_t *order, *by_size, *slot, size, max_size = 0, b, i, j;
+  unsigned long d;
+  char *taken;
+  const frozen_key *k;
+  frozen_entry *e;
+  int result = 0;
+
+  /* counting sort of the buckets, largest first */
+  for (b = 0; b < nb; b++) {
+    if (start[b + 1] - start[b] > max_size) {
+      max_size = start[b + 1] - start[b];
+    }
+  }
+  order = (size_t *) malloc(nb * sizeof(size_t));
+  by_size = (size_t *) calloc(max_size + 2, sizeof(size_t));
+  slot = (size_t *) malloc((max_size + 1) * sizeof(size_t));
+  taken = (char *) calloc(n + 1, 1);
+  if (order == NULL || by_size == NULL || slot == NULL || taken == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  for (b = 0; b < nb; b++) {
+    by_size[max_size - (start[b + 1] - start[b]) + 1]++;
+  }
+  for (i = 1; i <= max_size + 1; i++) {
+    by_size[i] += by_size[i - 1];
+  }
+  for (b = 0; b < nb; b++) {
+    order[by_size[max_size - (start[b + 1] - start[b])]++] = b;
+  }
+
+  for (i = 0; i < nb && result == 0; i++) {
+    b = order[i];
+    size = start[b + 1] - start[b];
+    if (size == 0) {
+      break;  /* only empty buckets are left */
+    }
+    for (d = 0; d < MAX_DISP; d++) {
+      for (j = 0; j < size; j++) {
+        slot[j] = slot_of(keys[start[b] + j].hash, (uint32_t) d, n);
+        if (taken[slot[j]]) {
+          break;
+        }
+        taken[slot[j]] = 1;
+      }
+      if (j == size) {
+        break;
+      }
+      while (j > 0) {  /* undo the partial placement */
+        taken[slot[--j]] = 0;
+      }
+    }
+    if (d == MAX_DISP) {
+      result = -1;
+      break;
+    }
+
+    ft->disp[b] = (uint32_t) d;
+    for (j = 0; j < size; j++) {
+      k = &keys[start[b] + j];
+      e = &ft->entries[slot[j]];
+      e->check = (uint32_t) (k->hash >> 32);
+      e->len = k->len;
+      e->key_off = k->key_off;
+      e->value = k->value;
+    }
+  }
+
+  free(order);
+  free(by_size);
+  free(slot);
+  free(taken);
+  return result;
+}
+
+
+/* freeze_hash_table: build a frozen copy of a hash table.
+ * arguments: ht: the table to copy
+ * return: pointer to the frozen table, or NULL if the key text is over
+ *         UINT32_MAX bytes or no perfect hash was found
+ */
+frozen_table *freeze_hash_table(hash_table *ht)
+{
+  frozen_table *ft;
+  frozen_key *grouped;
+  collector c;
+  size_t *start, n = ht->count, b, i;
+
+  ft = (frozen_table *) malloc(sizeof(frozen_table));
+  if (ft == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  ft->count = n;
+  ft->nbuckets = n / BUCKET_SIZE + 1;
+  ft->keys_size = 0;
+  for_each_node(ht, sum_key_size, &ft->keys_size);
+  if (ft->keys_size > UINT32_MAX) {
+    free(ft);
+    return NULL;
+  }
+
+  /* one extra element each keeps the allocations non-empty */
+  ft->disp = (uint32_t *) calloc(ft->nbuckets, sizeof(uint32_t));
+  ft->entries = (frozen_entry *) calloc(n + 1, sizeof(frozen_entry));
+  ft->keys = (char *) malloc(ft->keys_size + 1);
+  c.keys = (frozen_key *) malloc((n + 1) * sizeof(frozen_key));
+  grouped = (frozen_key *) malloc((n + 1) * sizeof(frozen_key));
+  start = (size_t *) calloc(ft->nbuckets + 1, sizeof(size_t));
+  if (ft->disp == NULL || ft->entries == NULL || ft->keys == NULL ||
+      c.keys == NULL || grouped == NULL || start == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  c.n = 0;
+  c.text = ft->keys;
+  c.text_size = 0;
+  for_each_node(ht, collect_key, &c);
+
+  /* group the keys by bucket */
+  for (i = 0; i < n; i++) {
+    start[bucket_of(c.keys[i].hash, ft->nbuckets) + 1]++;
+  }
+  for (b = 0; b < ft->nbuckets; b++) {
+    start[b + 1] += start[b];
+  }
+  for (i = 0; i < n; i++) {
+    grouped[start[bucket_of(c.keys[i].hash, ft->nbuckets)]++] = c.keys[i];
+  }
+  for (b = ft->nbuckets; b > 0; b--) {  /* filling moved every start up */
+    start[b] = start[b - 1];
+  }
+  start[0] = 0;
+
+  if (place_buckets(ft, grouped, start) != 0) {
+    free_frozen_table(ft);
+    ft = NULL;
+  }
+  free(c.keys);
+  free(grouped);
+  free(start);
+  return ft;
+}
+
+
+/* free_frozen_table: free a frozen table.
+ * arguments: ft: pointer to the table to be freed
+ */
+void free_frozen_table(frozen_table *ft)
+{
+  free(ft->disp);
+  free(ft->entries);
+  free(ft->keys);
+  free(ft);
+}
+
+
+/* frozen_get_value: look up a key.
+ * arguments: ft: the table
+ *            key, len: the key
+ * return: the value at the key, or 0 if the key isn't in the table
+ */
+int frozen_get_value(const frozen_table *ft, const char *key, size_t len)
+{
+  uint64_t hash = hash64(key, len);
+  const frozen_entry *e;
+
+  if (ft->count == 0) {
+    return 0;
+  }
+  e = &ft->entries[slot_of(hash, ft->disp[bucket_of(hash, ft->nbuckets)],
+                           ft->count)];
+  if (e->check == (uint32_t) (hash >> 32) && e->len == len &&
+      memcmp(ft->keys + e->key_off, key, len) == 0) {
+    return e->value;
+  }
+  return 0;
+}
+
+
+/* frozen_table_bytes: memory used by a frozen table.
+ * arguments: ft: the table
+ * return: number of bytes in the table and its arrays
+ */
+size_t frozen_table_bytes(const frozen_table *ft)
+{
+  return sizeof(frozen_table) + ft->nbuckets * sizeof(uint32_t) +
+         ft->count * sizeof(frozen_entry) + ft->keys_size;
+}
@@ -0,0 +1,70 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: frozen_table.h
+ *
+ *       A read-only snapshot of a hash table built around a minimal
+ *       perfect hash: every one of the n keys maps to its own slot in an
+ *       array of exactly n entries, so a lookup is one hash, one entry
+ *       and one key comparison, and no slot is ever empty.
+ *
+ */
+
+#ifndef FROZEN_TABLE_H
+#define FROZEN_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_table.h"
+
+/*
+ * One key.  'check' is the high half of the key's hash, compared before
+ * the key itself so a missing key is almost always rejected without
+ * reading the key text.
+ */
+
+typedef struct
+{
+    uint32_t check;
+    uint32_t len;
+    uint32_t key_off;  /* offset of the key in 'keys' */
+    int      value;
+} frozen_entry;
+
+/*
+ * A key's bucket is picked by its hash; each bucket has a displacement
+ * that was chosen so that its keys land on slots no other key uses.
+ */
+
+typedef struct
+{
+    size_t        count;     /* number of keys and of entries */
+    size_t        nbuckets;
+    uint32_t     *disp;      /* displacement of each bucket */
+    frozen_entry *entries;
+    char         *keys;      /* every key followed by a zero byte */
+    size_t        keys_size;
+} frozen_table;
+
+
+/*
+ * Build a frozen copy of the keys and values in 'ht', which is left
+ * unchanged.  Return NULL if the key text (every key and its zero byte)
+ * is over UINT32_MAX bytes, too much for the 32-bit key offsets, or if
+ * no perfect hash could be found (only possible if two keys share a
+ * 64-bit hash).
+ */
+frozen_table *freeze_hash_table(hash_table *ht);
+
+void free_frozen_table(frozen_table *ft);
+
+/*
+ * Look up the 'len'-byte key at 'key'.  Return its value, or 0 if it is
+ * not in the table.
+ */
+int frozen_get_value(const frozen_table *ft, const char *key, size_t len);
+
+/* Return the number of bytes the table occupies. */
+size_t frozen_table_bytes(const frozen_table *ft);
+
+#endif  /* FROZEN_TABLE_H */
@@ -0,0 +1,217 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: hash_map.h
+ *
+ *       A hash map generated for given key and value types, in the
+ *       manner of a C++ template.  Keys and values are stored by value
+ *       inside the slot array (open addressing with linear probing), so
+ *       a map with integer or small struct keys holds no pointers at all,
+ *       and hashing and comparing keys are calls the compiler can inline.
+ *
+ *       HASH_MAP_TYPES(name, K, V) declares the types:
+ *
+ *         name_entry   a slot: { K key; V value; }
+ *         name         the map
+ *
+ *       HASH_MAP_FUNCTIONS(name, K, V, hash_fn, equal_fn) defines the
+ *       functions, where hash_fn(const K *) returns a well-mixed
+ *       uint64_t and equal_fn(const K *, const K *) returns nonzero for
+ *       equal keys (either may be a macro):
+ *
+ *         name *name_create(void)
+ *         void  name_free(name *m)
+ *         V    *name_get(const name *m, const K *key)
+ *                  the key's value, or NULL if it isn't in the map
+ *         V    *name_put(name *m, const K *key, int *inserted)
+ *                  the key's value, inserting the key with a zeroed
+ *                  value if needed; '*inserted' tells which happened.
+ *                  The pointer is good until the next insert or remove.
+ *         int   name_remove(name *m, const K *key)
+ *                  1 if the key was removed, 0 if it wasn't in the map
+ *         name_entry *name_next(const name *m, size_t *pos)
+ *                  the next entry at or after slot '*pos', which is
+ *                  advanced past it; NULL at the end ('*pos' starts at 0)
+ *
+ *       HASH_MAP_DEFINE(name, K, V, hash_fn, equal_fn) does both.  Put
+ *       the types in a header and the functions in one source file (after
+ *       memcheck.h, so their allocations are tracked) to use the map from
+ *       several files through wrappers.
+ *
+ */
+
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_table.h"
+
+/* Slots in a new map; a power of two. */
+#define HASH_MAP_MIN_CAPACITY 16
+
+/* Unused generated functions draw no warnings, and the rest inline. */
+#define HASH_MAP_FN static __inline__
+
+
+/*** Ready-made hash and equality functions. ***/
+
+/* For integer keys. */
+#define hash_map_int_hash(k) mix64((uint64_t) *(k))
+#define hash_map_int_equal(a, b) (*(a) == *(b))
+
+/* For struct keys without padding: compares and hashes the bytes. */
+#define hash_map_bytes_hash(k) mix64(hash64((const char *) (k), sizeof(*(k))))
+#define hash_map_bytes_equal(a, b) (memcmp((a), (b), sizeof(*(a))) == 0)
+
+
+#define HASH_MAP_TYPES(name, K, V)                                          \
+                                                                            \
+typedef struct                                                              \
+{                                                                           \
+    K key;                                                                  \
+    V value;                                                                \
+} name##_entry;                                                             \
+                                                                            \
+typedef struct                                                              \
+{                                                                           \
+    size_t capacity;         /* number of slots: a power of two */          \
+    size_t count;            /* number of keys */                           \
+    unsigned char *used;     /* used[i] is 1 if slot i holds a key */       \
+    name##_entry *entries;                                                  \
+} name;
+
+
+#define HASH_MAP_FUNCTIONS(name, K, V, hash_fn, equal_fn)                   \
+                                                                            \
+/* name_alloc: give a map empty slot arrays of the given size. */           \
+HASH_MAP_FN void name##_alloc(name *m, size_t capacity)                     \
+{                                                                           \
+  m->capacity = capacity;                                                   \
+  m->count = 0;                                                             \
+  m->used = (unsigned char *) calloc(capacity, 1);                          \
+  m->entries = (name##_entry *) malloc(capacity * sizeof(name##_entry));    \
+  if (m->used == NULL || m->entries == NULL) {                              \
+    fprintf(stderr, "Error allocating memory.\n");                          \
+    exit(1);                                                                \
+  }                                                                         \
+}                                                                           \
+                                                                            \
+HASH_MAP_FN name *name##_create(void)                                       \
+{                                                                           \
+  name *m = (name *) malloc(sizeof(name));                                  \
+  if (m == NULL) {                                                          \
+    fprintf(stderr, "Error allocating memory.\n");                          \
+    exit(1);                                                                \
+  }                                                                         \
+  name##_alloc(m, HASH_MAP_MIN_CAPACITY);                                   \
+  return m;                                                                 \
+}                                                                           \
+                                                                            \
+HASH_MAP_FN void name##_free(name *m)                                       \
+{                                                                           \
+  free(m->used);                                                            \
+  free(m->entries);                                                         \
+  free(m);                                                                  \
+}                                                                           \
+                                                                            \
+/* name_find: index of the key's slot, or of the empty slot that ends its   \
+ * probe sequence. */                                                       \
+HASH_MAP_FN size_t name##_find(const name *m, const K *key)                 \
+{                                                                           \
+  size_t mask = m->capacity - 1, i;                                         \
+  for (i = (size_t) (hash_fn(key)) & mask; m->used[i]; i = (i + 1) & mask) {\
+    if (equal_fn(&m->entries[i].key, key)) {                                \
+      break;                                                                \
+    }                                                                       \
+  }                                                                         \
+  return i;                                                                 \
+}                                                                           \
+                                                                            \
+/* name_grow: move every entry into arrays twice the size. */               \
+HASH_MAP_FN void name##_grow(name *m)                                       \
+{                                                                           \
+  unsigned char *old_used = m->used;                                        \
+  name##_entry *old_entries = m->entries;                                   \
+  size_t old_capacity = m->capacity, i, j, count = m->count;                \
+                                                                            \
+  name##_alloc(m, 2 * old_capacity);                                        \
+  for (i = 0; i < old_capacity; i++) {                                      \
+    if (old_used[i]) {                                                      \
+      j = name##_find(m, &old_entries[i].key);                              \
+      m->used[j] = 1;                                                       \
+      m->entries[j] = old_entries[i];                                       \
+    }                                                                       \
+  }                                                                         \
+  m->count = count;                                                         \
+  free(old_used);                                                           \
+  free(old_entries);                                                        \
+}                                                                           \
+                                                                            \
+HASH_MAP_FN V *name##_get(const name *m, const K *key)                      \
+{                                                                           \
+  size_t i = name##_find(m, key);                                           \
+  return m->used[i] ? &m->entries[i].value : NULL;                          \
+}                                                                           \
+                                                                            \
+HASH_MAP_FN V *name##_put(name *m, const K *key, int *inserted)             \
+{                                                                           \
+  size_t i = name##_find(m, key);                                           \
+                                                                            \
+  *inserted = !m->used[i];                                                  \
+  if (*inserted) {                                                          \
+    /* grows at 3/4 full so probe sequences stay short */                   \
+    if (4 * (m->count + 1) > 3 * m->capacity) {                             \
+      name##_grow(m);                                                       \
+      i = name##_find(m, key);                                              \
+    }                                                                       \
+    m->used[i] = 1;                                                         \
+    m->entries[i].key = *key;                                               \
+    memset(&m->entries[i].value, 0, sizeof(V));                             \
+    m->count++;                                                             \
+  }                                                                         \
+  return &m->entries[i].value;                                              \
+}                                                                           \
+                                                                            \
+/* name_remove: entries after the removed one in its cluster are shifted  \
+ * back into the hole, unless that would put them before their home slot, \
+ * so the map never needs tombstones and stays as fast after deletes. */  \
+HASH_MAP_FN int name##_remove(name *m, const K *key)                        \
+{                                                                           \
+  size_t mask = m->capacity - 1, i = name##_find(m, key), j, home;          \
+                                                                            \
+  if (!m->used[i]) {                                                        \
+    return 0;                                                               \
+  }                                                                         \
+  for (j = (i + 1) & mask; m->used[j]; j = (j + 1) & mask) {                \
+    home = (size_t) (hash_fn(&m->entries[j].key)) & mask;                   \
+    /* the hole 'i' lies between the entry's home and 'j' */                \
+    if (((j - home) & mask) >= ((j - i) & mask)) {                          \
+      m->entries[i] = m->entries[j];                                        \
+      i = j;                                                                \
+    }                                                                       \
+  }                                                                         \
+  m->used[i] = 0;                                                           \
+  m->count--;                                                               \
+  return 1;                                                                 \
+}                                                                           \
+                                                                            \
+HASH_MAP_FN name##_entry *name##_next(const name *m, size_t *pos)           \
+{                                                                           \
+  for (; *pos < m->capacity; (*pos)++) {                                    \
+    if (m->used[*pos]) {                                                    \
+      return &m->entries[(*pos)++];                                         \
+    }                                                                       \
+  }                                                                         \
+  return NULL;                                                              \
+}
+
+
+#define HASH_MAP_DEFINE(name, K, V, hash_fn, equal_fn)                      \
+  HASH_MAP_TYPES(name, K, V)                                                \
+  HASH_MAP_FUNCTIONS(name, K, V, hash_fn, equal_fn)
+
+#endif  /* HASH_MAP_H */
@@ -7,6 +7,8 @@
  *
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 /*
  * Include the declaration of the hash table data structures
  * and the function prototypes.
@@ -15,22 +17,73 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "hash_table.h"
+#include "table_output.h"
+#include "table_image.h"
+#include "bloom_filter.h"
 #include "memcheck.h"
 
+/*
+ * With HT_STATS, searches count as hits or misses and resizes are
+ * counted and timed.  Without it these compile to nothing.
+ */
+#ifdef HT_STATS
+#define COUNT_SEARCH(ht, found) \
+  ((found) ? (ht)->counters.hits++ : (ht)->counters.misses++)
+#else
+#define COUNT_SEARCH(ht, found) ((void) 0)
+#endif
+
 /*** Hash function. ***/
 
-/* hash: takes in a string and returns a hash index
+/* hash: takes in a string and returns its hash value
  * arguments: s: string to be hashed
- * return: int representing hash value from 0 TO NSLOTS
+ * return: 64-bit hash value; the slot is its low bits
+ */
+uint64_t hash(char *s)
+{
+  return hash64(s, strlen(s));
+}
+
+
+/* hash64: 64-bit FNV-1a hash of a string given by start and length
+ * arguments: s: first character of the string
+ *            len: number of characters to hash
+ * return: the hash value
  */
-int hash(char *s)
+uint64_t hash64(const char *s, size_t len)
 {
-  int sum = 0; /* sum of character values */
-  for (; *s != '\0'; s++) {
-    sum += (int) (*s);
+  uint64_t h = 14695981039346656037UL;
+  for (; len > 0; s++, len--) {
+    h = (h ^ (unsigned char) *s) * 1099511628211UL;
   }
-  return sum % NSLOTS;
+  return h;
+}
+
+
+/* mix64: scramble the bits of a 64-bit value (the splitmix64 finalizer).
+ * arguments: x: value to scramble, usually a hash
+ * return: a value every bit of which depends on every bit of 'x'
+ */
+uint64_t mix64(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9UL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBUL;
+  return x ^ (x >> 31);
+}
+
+
+/* table_counters_enabled: whether this file was built with HT_STATS.
+ * return: 1 if the table counters are kept up to date, 0 if not
+ */
+int table_counters_enabled(void)
+{
+#ifdef HT_STATS
+  return 1;
+#else
+  return 0;
+#endif
 }
 
 
@@ -38,10 +91,12 @@ int hash(char *s)
 
 /* create_node: create a single node. 
  * arguments: key: has key
+ *            len: length of key
+ *            hash: hash value of key
  *            value: value of node
  * return: pointer to created node with key and value
  */
-node *create_node(char *key, int value)
+node *create_node(char *key, size_t len, uint64_t hash, int value)
 {
   node *n; /* new node to be created */
   n = (node *) malloc(sizeof(node)); 
@@ -53,6 +108,8 @@ node *create_node(char *key, int value)
 
   n->key = key;
   n->value = value;
+  n->hash = hash;
+  n->len = len;
   n->next = NULL;
   return n;
 }
@@ -76,6 +133,210 @@ void free_list(node *list)
 
 /*** Hash table utilities. ***/
 
+/* alloc_slots: allocate an empty slot array. 
+ * arguments: nslots: number of slots
+ * return: pointer to the array, with every slot NULL
+ */
+static node **alloc_slots(size_t nslots)
+{
+  node **slot;
+  slot = (node **) calloc(nslots, sizeof(node *));
+  if (slot == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  return slot;
+}
+
+
+/* move_chain: relink every node of a chain into the current slot array.
+ *             Each node carries its hash, so no key is rehashed or read.
+ * arguments: ht: pointer to hash table
+ *            n: first node of the chain
+ */
+static void move_chain(hash_table *ht, node *n)
+{
+  node *next;
+  for (; n != NULL; n = next) {
+    next = n->next;
+    n->next = ht->slot[n->hash & (ht->nslots - 1)];
+    ht->slot[n->hash & (ht->nslots - 1)] = n;
+  }
+}
+
+
+/* migrate: move up to 'nchains' chains of an incremental resize over,
+ *          and drop the old slot array once it is empty.
+ * arguments: ht: pointer to hash table being resized
+ *            nchains: most chains to move
+ */
+static void migrate(hash_table *ht, size_t nchains)
+{
+  for (; nchains > 0 && ht->migrated < ht->old_nslots; nchains--) {
+    move_chain(ht, ht->old_slot[ht->migrated]);
+    ht->old_slot[ht->migrated++] = NULL;
+  }
+  if (ht->migrated == ht->old_nslots) {
+    free(ht->old_slot);
+    ht->old_slot = NULL;
+  }
+}
+
+
+/* resize: double the slot array.  Without incremental resizing every
+ *         chain is moved right away; with it the old array is kept and
+ *         emptied a little per operation.
+ * arguments: ht: pointer to hash table to grow
+ */
+static void resize(hash_table *ht)
+{
+#ifdef HT_STATS
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+
+  /* a resize still in progress is finished first */
+  if (ht->old_slot != NULL) {
+    migrate(ht, ht->old_nslots);
+  }
+
+  ht->old_slot = ht->slot;
+  ht->old_nslots = ht->nslots;
+  ht->migrated = 0;
+  ht->nslots *= 2;
+  ht->slot = alloc_slots(ht->nslots);
+
+  migrate(ht, ht->incremental ? MIGRATE_STEP : ht->old_nslots);
+
+#ifdef HT_STATS
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  ht->counters.resizes++;
+  ht->counters.resize_seconds += (end.tv_sec - start.tv_sec) +
+                                 (end.tv_nsec - start.tv_nsec) / 1e9;
+#endif
+}
+
+
+/* find_in_chain: find the link that points at a key's node in one chain.
+ * arguments: link: slot holding the chain
+ *            key: first character of the key
+ *            len: length of the key
+ *            h: hash value of the key
+ * return: pointer to the 'next' field (or slot) holding the key's node,
+ *         or to the NULL at the end of the chain if the key isn't there
+ */
+static node **find_in_chain(node **link, const char *key, size_t len,
+                            uint64_t h)
+{
+  /* the hash and length reject almost every other key without
+   * touching its characters */
+  for (; *link != NULL; link = &(*link)->next) {
+    if ((*link)->hash == h && (*link)->len == len &&
+        memcmp((*link)->key, key, len) == 0) {
+      break;
+    }
+  }
+  return link;
+}
+
+
+/* find_link: find the link that points (or would point) at a key's node.
+ *            During an incremental resize this also moves a few chains,
+ *            and looks in the old slot array if the key isn't in the new
+ *            one.
+ * arguments: ht: pointer to hash table
+ *            key: first character of the key
+ *            len: length of the key
+ *            h: hash value of the key
+ * return: pointer to the 'next' field (or slot) holding the key's node,
+ *         or to the NULL at the end of the new chain if it isn't there
+ */
+static node **find_link(hash_table *ht, const char *key, size_t len,
+                        uint64_t h)
+{
+  node **link, **old;
+  size_t i;
+
+  if (ht->old_slot != NULL) {
+    migrate(ht, MIGRATE_STEP);
+  }
+
+  link = find_in_chain(&ht->slot[h & (ht->nslots - 1)], key, len, h);
+
+  /* a key in an old slot that hasn't been moved yet */
+  if (*link == NULL && ht->old_slot != NULL) {
+    i = h & (ht->old_nslots - 1);
+    if (i >= ht->migrated) {
+      old = find_in_chain(&ht->old_slot[i], key, len, h);
+      if (*old != NULL) {
+        return old;
+      }
+    }
+  }
+  return link;
+}
+
+
+/* check_writable: refuse to change a table mapped from a file.
+ * arguments: ht: pointer to hash table about to be changed
+ */
+static void check_writable(hash_table *ht)
+{
+  if (ht->image != NULL) {
+    fprintf(stderr, "Error: a loaded hash table is read-only.\n");
+    exit(1);
+  }
+}
+
+
+/* add_to_bloom: for_each_node callback adding a node to a filter */
+static void add_to_bloom(node *n, void *arg)
+{
+  bloom_add((bloom_filter *) arg, n->hash);
+}
+
+
+/* build_bloom: replace the table's filter with one sized for
+ *              'capacity' keys, refilled from the cached hashes.
+ * arguments: ht: pointer to hash table
+ *            capacity: number of keys to size the filter for
+ *            bits_per_key: bits of filter per key
+ */
+static void build_bloom(hash_table *ht, size_t capacity, int bits_per_key)
+{
+  if (ht->bloom != NULL) {
+    free_bloom_filter(ht->bloom);
+  }
+  ht->bloom = create_bloom_filter(capacity, bits_per_key);
+  for_each_node(ht, add_to_bloom, ht->bloom);
+}
+
+
+/* insert_node: add a node whose key is not yet in the table, growing
+ *              the table if it now has more keys than slots.
+ * arguments: ht: pointer to hash table
+ *            n: node to add
+ */
+static void insert_node(hash_table *ht, node *n)
+{
+  n->next = ht->slot[n->hash & (ht->nslots - 1)];
+  ht->slot[n->hash & (ht->nslots - 1)] = n;
+  if (ht->bloom != NULL) {
+    bloom_add(ht->bloom, n->hash);
+  }
+  if (++ht->count > ht->nslots) {
+    resize(ht);
+  }
+  /* removed keys stay in the filter, so it is rebuilt once it has had
+   * as many keys added as it was sized for, with room for twice the
+   * keys now in the table */
+  if (ht->bloom != NULL && ht->bloom->nadded > ht->bloom->capacity) {
+    build_bloom(ht, 2 * ht->count > NSLOTS ? 2 * ht->count : NSLOTS,
+                ht->bloom->bits_per_key);
+  }
+}
+
+
 /* create_hash_table: create a new hash table.  
  * return: pointer to empty hash table 
  */
@@ -88,10 +349,17 @@ hash_table *create_hash_table()
     exit(1);
   }
   /* slots are initialized to NULL */
-  ht->slot = (node**) calloc(NSLOTS, sizeof(node *));
-  if (ht->slot == NULL) {
-    fprintf(stderr, "Error allocating memory.\n");
-  }
+  ht->slot = alloc_slots(NSLOTS);
+  ht->nslots = NSLOTS;
+  ht->count = 0;
+  ht->incremental = 0;
+  ht->old_slot = NULL;
+  ht->old_nslots = 0;
+  ht->migrated = 0;
+  ht->image = NULL;
+  ht->image_size = 0;
+  ht->bloom = NULL;
+  memset(&ht->counters, 0, sizeof(table_counters));
   return ht;
 }
 
@@ -101,16 +369,62 @@ hash_table *create_hash_table()
  */
 void free_hash_table(hash_table *ht)
 {
-  int i;
+  size_t i;
+
+  if (ht->image != NULL) { /* nothing but the mapping to release */
+    unmap_image(ht->image, ht->image_size);
+    free(ht);
+    return;
+  }
   /* frees nodes in list */
-  for(i = 0; i < NSLOTS; i++) {
+  for(i = 0; i < ht->nslots; i++) {
       free_list(ht->slot[i]);
   }
   free(ht->slot); /* frees list itself */
+  if (ht->old_slot != NULL) { /* in the middle of a resize */
+    for (i = ht->migrated; i < ht->old_nslots; i++) {
+      free_list(ht->old_slot[i]);
+    }
+    free(ht->old_slot);
+  }
+  if (ht->bloom != NULL) {
+    free_bloom_filter(ht->bloom);
+  }
   free(ht);
 }
 
 
+/* set_incremental_resize: choose how the table grows.
+ * arguments: ht: pointer to hash table
+ *            on: 1 to resize incrementally, 0 to resize all at once
+ */
+void set_incremental_resize(hash_table *ht, int on)
+{
+  ht->incremental = on;
+  if (!on && ht->old_slot != NULL && ht->image == NULL) {
+    migrate(ht, ht->old_nslots);
+  }
+}
+
+
+/* set_bloom_filter: turn the Bloom filter in front of lookups on or off.
+ * arguments: ht: pointer to hash table
+ *            bits_per_key: bits of filter per key, or 0 for no filter
+ */
+void set_bloom_filter(hash_table *ht, int bits_per_key)
+{
+  check_writable(ht);
+  if (bits_per_key > 0) {
+    build_bloom(ht, ht->count > ht->nslots ? ht->count : ht->nslots,
+                bits_per_key);
+  }
+  else if (ht->bloom != NULL) {
+    free_bloom_filter(ht->bloom);
+    ht->bloom = NULL;
+  }
+}
+
+
 /*
  * get_value: look for a key in the hash table.
  * arguments: ht: pointer to hash table
@@ -119,16 +433,35 @@ void free_hash_table(hash_table *ht)
  */
 int get_value(hash_table *ht, char *key)
 {
-  node *n; 
- 
-  n = ht->slot[hash(key)];
-  /* node traverses the list under the hash value for key */
-  for (n = ht->slot[hash(key)]; n != NULL; n = n->next) {
-    if (strcmp(n->key, key) == 0) {
-      return n->value;
-    }
+  return lookup_value(ht, key, strlen(key));
+}
+
+
+/*
+ * lookup_value: look for a key given by start and length.
+ * arguments: ht: pointer to hash table
+ *            key: first character of the key
+ *            len: length of the key
+ * return: the associated value if there is one. Otherwise, return 0.
+ */
+int lookup_value(hash_table *ht, const char *key, size_t len)
+{
+  uint64_t h = hash64(key, len);
+  const image_entry *e;
+  node *n;
+
+  if (ht->image != NULL) { /* searched in place in the mapped file */
+    e = image_find(ht->image, key, len, h);
+    COUNT_SEARCH(ht, e != NULL);
+    return e != NULL ? (int) e->value : 0;
   }
-  return 0; /* key not found */
+  if (ht->bloom != NULL && !bloom_may_contain(ht->bloom, h)) {
+    COUNT_SEARCH(ht, 0);
+    return 0; /* certainly not in the table */
+  }
+  n = *find_link(ht, key, len, h);
+  COUNT_SEARCH(ht, n != NULL);
+  return n != NULL ? n->value : 0; /* 0 if key not found */
 }
 
 
@@ -141,29 +474,167 @@ int get_value(hash_table *ht, char *key)
  */
 void set_value(hash_table *ht, char *key, int value)
 {
+  size_t len = strlen(key);
+  uint64_t h = hash64(key, len);
+  node *n;
+
+  check_writable(ht);
+  n = *find_link(ht, key, len, h);
+  COUNT_SEARCH(ht, n != NULL);
+  if (n != NULL) { /* if keys match */
+    n->value = value;
+    free(key);
+  }
+  else { /* if key is not found, create new node */
+    insert_node(ht, create_node(key, len, h, value));
+  }
+}
+
+
+/*
+ * add_value: add to the value stored at a key given by start and length.
+ *            If the key is not in the table, a null-terminated copy of it
+ *            is made and stored in a new node with value 'delta'.
+ * arguments: ht: pointer to hash table
+ *            key: first character of the key
+ *            len: length of the key
+ *            delta: amount to add to the value
+ * return: the new value stored at the key
+ */
+int add_value(hash_table *ht, const char *key, size_t len, int delta)
+{
+  uint64_t h = hash64(key, len);
   node *n;
-  
-  n = ht->slot[hash(key)];
-  /* if hash not found, create a new node */
-  if (!n) {
-    ht->slot[hash(key)] = create_node(key, value);
+  char *copy;
+
+  check_writable(ht);
+  n = *find_link(ht, key, len, h);
+  COUNT_SEARCH(ht, n != NULL);
+  if (n != NULL) {
+    n->value += delta;
+    return n->value;
+  }
+
+  /* only keys new to the table are copied */
+  copy = (char *) malloc(len + 1);
+  if (copy == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  memcpy(copy, key, len);
+  copy[len] = '\0';
+  insert_node(ht, create_node(copy, len, h, delta));
+  return delta;
+}
+
+
+/*
+ * remove_key: remove a key given by start and length from the table.
+ * arguments: ht: pointer to hash table
+ *            key: first character of the key
+ *            len: length of the key
+ * return: 1 if the key was removed, 0 if it wasn't in the table
+ */
+int remove_key(hash_table *ht, const char *key, size_t len)
+{
+  node **link, *n;
+
+  check_writable(ht);
+  link = find_link(ht, key, len, hash64(key, len));
+  COUNT_SEARCH(ht, *link != NULL);
+  if (*link == NULL) {
+    return 0;
+  }
+  /* unlinks the node wherever it is, new or old slot array */
+  n = *link;
+  *link = n->next;
+  free(n->key);
+  free(n);
+  ht->count--;
+  return 1;
+}
+
+
+/*
+ * merge_hash_table: add the contents of one hash table into another.
+ *                   'src' is freed; its nodes are either relinked into
+ *                   'dst' or, if 'dst' already has the key, freed.
+ * arguments: dst: pointer to hash table to be added into
+ *            src: pointer to hash table to be emptied and freed
+ */
+void merge_hash_table(hash_table *dst, hash_table *src)
+{
+  size_t i;
+  node *n, *next, *d;
+
+  check_writable(dst);
+  check_writable(src);
+  if (src->old_slot != NULL) {
+    migrate(src, src->old_nslots);
+  }
+#ifdef HT_STATS
+  /* the searches and resizes that filled 'src' count for 'dst' */
+  dst->counters.hits += src->counters.hits;
+  dst->counters.misses += src->counters.misses;
+  dst->counters.resizes += src->counters.resizes;
+  dst->counters.resize_seconds += src->counters.resize_seconds;
+#endif
+  for (i = 0; i < src->nslots; i++) {
+    for (n = src->slot[i]; n != NULL; n = next) {
+      next = n->next;
+      d = *find_link(dst, n->key, n->len, n->hash);
+      if (d != NULL) { /* key already counted in dst */
+        d->value += n->value;
+        free(n->key);
+        free(n);
+      }
+      else { /* moves the node over as is */
+        insert_node(dst, n);
+      }
+    }
+    src->slot[i] = NULL;
+  }
+  free_hash_table(src);
+}
+
+
+/*
+ * for_each_node: visit every node of the hash table.
+ * arguments: ht: pointer to hash table
+ *            fn: function called with each node and 'arg'
+ *            arg: passed through to 'fn'
+ */
+void for_each_node(hash_table *ht, void (*fn)(node *n, void *arg), void *arg)
+{
+  size_t i;
+  node *n;
+
+  if (ht->image != NULL) {
+    image_for_each(ht->image, fn, arg);
     return;
   }
-  /* traverses the list indexed by the hash for correct key */
-  for (; n != NULL; n = n->next) {
-    if (strcmp(n->key, key) == 0) { /* if keys match */
-      n->value = value;
-      free(key); 
-      break;
+  for (i = 0; i < ht->nslots; i++) {
+    for (n = ht->slot[i]; n != NULL; n = n->next) {
+      fn(n, arg);
     }
-    if (!n->next) { /* if key is not found, create new node */
-      n->next = create_node(key, value);
-      break;
+  }
+  if (ht->old_slot != NULL) { /* chains not yet moved by a resize */
+    for (i = ht->migrated; i < ht->old_nslots; i++) {
+      for (n = ht->old_slot[i]; n != NULL; n = n->next) {
+        fn(n, arg);
+      }
     }
   }
 }
 
 
+/* print_node: for_each_node callback writing a node as 'key value' */
+static void print_node(node *n, void *arg)
+{
+  out_pair((out_buffer *) arg, n->key, n->len, n->value);
+}
+
+
 /* 
  * print_hash_table: print out the contents of the hash table 
  *                   as key/value pairs. 
@@ -171,12 +642,10 @@ void set_value(hash_table *ht, char *key, int value)
  */
 void print_hash_table(hash_table *ht)
 {
-  int i;
-  node *n;
-  for (i = 0; i < NSLOTS; i++) {
-    /* prints each key/value pair as 'key value' */
-    for (n = ht->slot[i]; n != NULL; n = n->next) {
-      printf("%s %d\n", n->key, n->value);
-    }
-  }
+  out_buffer out;
+
+  /* prints each key/value pair as 'key value' through one big buffer */
+  out_open(&out, stdout);
+  for_each_node(ht, print_node, &out);
+  out_close(&out);
 }
@@ -15,13 +15,39 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
-/* Number of slots in the hash table array. */
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Number of slots a new hash table starts with.  The table doubles
+ * whenever it holds more keys than slots.
+ */
 #define NSLOTS 128
 
+/*
+ * With incremental resizing, the number of old slots each operation
+ * moves into the new slot array.
+ */
+#define MIGRATE_STEP 8
+
 /*
  * Data structure definitions.
  */
 
+/*
+ * Operation counters.  They are only updated when hash_table.c is built
+ * with HT_STATS defined, but always take up room in the table, so code
+ * built either way agrees on its layout.  See table_stats.h.
+ */
+
+typedef struct
+{
+    unsigned long hits;     /* searches that found their key */
+    unsigned long misses;   /* searches that didn't */
+    unsigned long resizes;  /* times the slot array grew */
+    double resize_seconds;  /* time spent in those resizes */
+} table_counters;
+
 /*
  * Declaration of the linked list `node' struct.
  */
@@ -30,17 +56,40 @@ typedef struct _node
 {
     char *key;
     int value;
+    uint64_t hash;  /* full hash of the key, so it's never recomputed */
+    size_t len;     /* length of the key */
     struct _node *next; /* pointer to the next node in the list */
 } node;
 
 /*
  * Declaration of the hash table struct.
  * 'slot' is an array of node pointers, so it's a pointer to a pointer.
+ * A key lives in slot (hash & (nslots - 1)).
+ *
+ * With incremental resizing, growing the table only allocates the new
+ * slot array; the old one is kept in 'old_slot' and every operation
+ * moves a few of its chains over.  Old slots below 'migrated' are empty.
+ *
+ * A table loaded from a file (see table_image.h) has no slots; 'image'
+ * points at the read-only mapping of the file instead.
+ *
+ * 'bloom', if not NULL, holds the hash of every key in the table, so
+ * most lookups of missing keys never reach a slot.
  */
 
 typedef struct
 {
     node **slot;
+    size_t nslots;  /* size of 'slot': a power of two */
+    size_t count;   /* number of keys in the table */
+    int incremental;     /* 1 to resize incrementally */
+    node **old_slot;     /* slot array being emptied, or NULL */
+    size_t old_nslots;   /* size of 'old_slot' */
+    size_t migrated;     /* old slots already moved */
+    const void *image;   /* mapped table image, or NULL */
+    size_t image_size;   /* size of the mapping */
+    struct _bloom_filter *bloom;  /* see bloom_filter.h; NULL if off */
+    table_counters counters;
 } hash_table;
 
 
@@ -50,13 +99,29 @@ typedef struct
 
 /*** Hash function. ***/
 
-int hash(char *s);
+uint64_t hash(char *s);
+
+/* Hash the first 'len' bytes of 's' (which need not be null-terminated). */
+uint64_t hash64(const char *s, size_t len);
+
+/*
+ * Scramble the bits of a hash.  Anything that needs hash bits other
+ * than the low ones (used for the slot) should take them from here.
+ */
+uint64_t mix64(uint64_t x);
+
+
+/* Return 1 if the table counters are kept (HT_STATS), 0 if not. */
+int table_counters_enabled(void);
 
 
 /*** Linked list utilities. ***/
 
-/* Create a single node whose 'next' field is NULL. */
-node *create_node(char *key, int value);
+/*
+ * Create a single node whose 'next' field is NULL.  'len' and 'hash'
+ * must be the length and hash of 'key'.
+ */
+node *create_node(char *key, size_t len, uint64_t hash, int value);
 
 /* Free all the nodes of a linked list. */
 void free_list(node *list);
@@ -68,12 +133,29 @@ hash_table *create_hash_table(void);
 
 void free_hash_table(hash_table *ht);
 
+/*
+ * Turn incremental resizing on (1) or off (0).  When it is on, no single
+ * operation moves more than MIGRATE_STEP chains, so insert latency stays
+ * bounded as the table grows.
+ */
+void set_incremental_resize(hash_table *ht, int on);
+
+/*
+ * Keep a Bloom filter of the keys with about 'bits_per_key' bits per key
+ * (about 1% false positives at 10), so lookups of missing keys can skip
+ * the chains.  0 drops the filter.
+ */
+void set_bloom_filter(hash_table *ht, int bits_per_key);
+
 /*
  * Look for a key in the hash table.  Return 0 if not found.
  * If it is found return the associated value.
  */
 int get_value(hash_table *ht, char *key);
 
+/* Same as get_value() for a key given by its start and length. */
+int lookup_value(hash_table *ht, const char *key, size_t len);
+
 /*
  * Set the value stored at a key.  If the key is not in the table,
  * create a new node and set the value to 'value'.  Note that this
@@ -81,6 +163,33 @@ int get_value(hash_table *ht, char *key);
  */
 void set_value(hash_table *ht, char *key, int value);
 
+/*
+ * Add 'delta' to the value stored at the 'len'-byte key starting at 'key'
+ * and return the new value.  The key need not be null-terminated; it is
+ * only copied (into a new allocation owned by the table) if it isn't
+ * already in the table.
+ */
+int add_value(hash_table *ht, const char *key, size_t len, int delta);
+
+/*
+ * Remove the 'len'-byte key at 'key' and free its node.  Return 1 if
+ * the key was in the table and 0 if it wasn't.  The slot array is not
+ * shrunk.
+ */
+int remove_key(hash_table *ht, const char *key, size_t len);
+
+/*
+ * Add every key/value pair of 'src' into 'dst' and free 'src'.  Keys
+ * that are new to 'dst' are moved over without being copied.
+ */
+void merge_hash_table(hash_table *dst, hash_table *src);
+
+/*
+ * Call 'fn' on every node of the table.  'fn' must not add or remove
+ * keys.
+ */
+void for_each_node(hash_table *ht, void (*fn)(node *n, void *arg), void *arg);
+
 /* Print out the contents of the hash table as key/value pairs. */
 void print_hash_table(hash_table *ht);
 
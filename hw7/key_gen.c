@@ -0,0 +1,305 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: key_gen.c
+ *
+ *       Implementation of the generated key sets.
+ *
+ *       Zipf keys spell their rank in bijective base 100, one consonant-
+ *       vowel syllable per digit, so the most frequent keys are the
+ *       shortest and no two ranks give the same key; absent keys add a
+ *       final 'q'.  Uniform keys spell mix64() of their index in base 32;
+ *       mix64() is a bijection, so they are distinct too.
+ *
+ *       Adversarial keys are a unique prefix plus four characters chosen
+ *       so the low bits of the FNV-1a hash come out zero.  Those bits
+ *       only depend on the low bits of each step, and a step can be
+ *       undone by multiplying by the inverse of the FNV prime, so the
+ *       last two characters are looked up in a table of states that
+ *       they take to zero (meet in the middle).  The chained table and
+ *       the probed tables index their slots with exactly these bits.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "key_gen.h"
+#include "hash_table.h"
+#include "memcheck.h"
+
+/* Zipf vocabulary: this many keys per square root of the stream. */
+#define ZIPF_VOCAB_FACTOR 40
+
+/* Largest uniform and adversarial vocabularies. */
+#define UNIFORM_MAX_KEYS (1UL << 22)
+#define ADVERSARIAL_MAX_KEYS 1024
+
+#define FNV_PRIME 1099511628211UL
+#define LOW_MASK ((1UL << ADVERSARIAL_BITS) - 1)
+
+/* Printable characters used in the chosen part of adversarial keys. */
+#define FIRST_CHAR '!'
+#define NCHARS ('~' - '!' + 1)
+
+
+const char *key_dist_name(key_dist dist)
+{
+  return dist == KEYS_ZIPF ? "zipf" :
+         dist == KEYS_UNIFORM ? "uniform" : "adversarial";
+}
+
+
+unsigned long key_random(unsigned long *state)
+{
+  *state = *state * 6364136223846793005UL + 1442695040888963407UL;
+  return (*state >> 33) & 0x7FFFFFFFUL;
+}
+
+
+/* key_set_size: vocabulary for a stream.
+ * arguments: dist: the distribution
+ *            ntokens: length of the stream
+ * return: number of present keys
+ */
+size_t key_set_size(key_dist dist, size_t ntokens)
+{
+  size_t root = 1, n;
+
+  switch (dist) {
+  case KEYS_ZIPF:
+    while ((root + 1) * (root + 1) <= ntokens) {
+      root++;
+    }
+    n = ZIPF_VOCAB_FACTOR * root;
+    break;
+  case KEYS_UNIFORM:
+    n = UNIFORM_MAX_KEYS;
+    break;
+  default:
+    n = ADVERSARIAL_MAX_KEYS;
+    break;
+  }
+  return n < ntokens ? n : ntokens;
+}
+
+
+/*** Keys. ***/
+
+/* zipf_key: spell a rank as syllables.
+ * arguments: rank: the key's rank
+ *            absent: 1 for the absent key of this rank
+ *            key: where to write the key
+ * return: length of the key
+ */
+static size_t zipf_key(size_t rank, int absent, char *key)
+{
+  static const char consonants[] = "bcdfghjklmnprstvwxyz";
+  static const char vowels[] = "aeiou";
+  size_t x = rank + 1, len = 0;
+
+  while (x > 0) {
+    x--;
+    key[len++] = consonants[x % 100 / 5];
+    key[len++] = vowels[x % 5];
+    x /= 100;
+  }
+  if (absent) {
+    key[len++] = 'q';
+  }
+  key[len] = '\0';
+  return len;
+}
+
+
+/* uniform_key: spell a scrambled index in base 32.
+ * arguments: i: index among the present or absent keys
+ *            absent: 1 for an absent key
+ *            key: where to write the key
+ * return: length of the key
+ */
+static size_t uniform_key(size_t i, int absent, char *key)
+{
+  static const char digits[] = "abcdefghijklmnopqrstuvwxyz234567";
+  uint64_t x = mix64((uint64_t) i | (uint64_t) absent << 63);
+  size_t len;
+
+  for (len = 0; len < 13; len++, x >>= 5) {
+    key[len] = digits[x & 31];
+  }
+  key[len] = '\0';
+  return len;
+}
+
+
+/* build_backward: find the pairs of characters that end a key with
+ *                 its low hash bits all zero.
+ * return: table indexed by the low bits of the hash state before the
+ *         pair, holding 1 + the pair's number (c * NCHARS + d), or 0
+ */
+static unsigned short *build_backward(void)
+{
+  unsigned short *back;
+  uint64_t inverse = FNV_PRIME, state;
+  int i, c, d;
+
+  /* Newton's iteration doubles the correct low bits of the inverse */
+  for (i = 0; i < 6; i++) {
+    inverse *= 2 - FNV_PRIME * inverse;
+  }
+  back = (unsigned short *) calloc(LOW_MASK + 1, sizeof(unsigned short));
+  if (back == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  for (c = 0; c < NCHARS; c++) {
+    for (d = 0; d < NCHARS; d++) {
+      /* undo the steps for d, then c, from a state of zero: each step
+       * is state = (state ^ char) * FNV_PRIME */
+      state = (uint64_t) (FIRST_CHAR + d);
+      state = (state * inverse) ^ (uint64_t) (FIRST_CHAR + c);
+      back[state & LOW_MASK] = (unsigned short) (1 + c * NCHARS + d);
+    }
+  }
+  return back;
+}
+
+
+/* adversarial_key: make a key whose low hash bits are zero.
+ * arguments: i: index among the present or absent keys
+ *            absent: 1 for an absent key
+ *            back: table from build_backward()
+ *            key: where to write the key
+ * return: length of the key
+ */
+static size_t adversarial_key(size_t i, int absent, const unsigned short *back,
+                              char *key)
+{
+  size_t len = (size_t) sprintf(key, "%c%lx", absent ? 'y' : 'x',
+                                (unsigned long) i);
+  uint64_t prefix = hash64(key, len), state;
+  int a, b, pair;
+
+  for (a = 0; a < NCHARS; a++) {
+    for (b = 0; b < NCHARS; b++) {
+      state = (prefix ^ (uint64_t) (FIRST_CHAR + a)) * FNV_PRIME;
+      state = (state ^ (uint64_t) (FIRST_CHAR + b)) * FNV_PRIME;
+      pair = back[state & LOW_MASK];
+      if (pair != 0) {
+        key[len++] = (char) (FIRST_CHAR + a);
+        key[len++] = (char) (FIRST_CHAR + b);
+        key[len++] = (char) (FIRST_CHAR + (pair - 1) / NCHARS);
+        key[len++] = (char) (FIRST_CHAR + (pair - 1) % NCHARS);
+        key[len] = '\0';
+        return len;
+      }
+    }
+  }
+  fprintf(stderr, "No adversarial key found for %lu!\n", (unsigned long) i);
+  exit(1);
+}
+
+
+/*** Key sets. ***/
+
+/* create_key_set: generate the keys for a stream.
+ * arguments: dist: the distribution
+ *            ntokens: length of the stream
+ * return: pointer to the new key set
+ */
+key_set *create_key_set(key_dist dist, size_t ntokens)
+{
+  key_set *ks;
+  unsigned short *back = NULL;
+  double total = 0;
+  size_t n, i, j;
+
+  ks = (key_set *) malloc(sizeof(key_set));
+  if (ks == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  n = key_set_size(dist, ntokens);
+  ks->dist = dist;
+  ks->nkeys = n;
+  ks->text = (char *) malloc(2 * n * KEY_STRIDE);
+  ks->lens = (unsigned char *) malloc(2 * n);
+  ks->cdf = NULL;
+  if (ks->text == NULL || ks->lens == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  if (dist == KEYS_ADVERSARIAL) {
+    back = build_backward();
+  }
+
+  for (j = 0; j < 2 * n; j++) {
+    i = j < n ? j : j - n;
+    ks->lens[j] = (unsigned char) (
+      dist == KEYS_ZIPF ? zipf_key(i, j >= n, KEY_AT(ks, j)) :
+      dist == KEYS_UNIFORM ? uniform_key(i, j >= n, KEY_AT(ks, j)) :
+      adversarial_key(i, j >= n, back, KEY_AT(ks, j)));
+  }
+  free(back);
+
+  /* key i is drawn with weight 1 / (i + 1) */
+  if (dist == KEYS_ZIPF) {
+    ks->cdf = (double *) malloc(n * sizeof(double));
+    if (ks->cdf == NULL) {
+      fprintf(stderr, "Error allocating memory.\n");
+      exit(1);
+    }
+    for (i = 0; i < n; i++) {
+      total += 1.0 / (i + 1);
+      ks->cdf[i] = total;
+    }
+    for (i = 0; i < n; i++) {
+      ks->cdf[i] /= total;
+    }
+  }
+  return ks;
+}
+
+
+/* free_key_set: free a key set.
+ * arguments: ks: pointer to the key set to be freed
+ */
+void free_key_set(key_set *ks)
+{
+  free(ks->text);
+  free(ks->lens);
+  free(ks->cdf);
+  free(ks);
+}
+
+
+/* draw_key: draw a present key.
+ * arguments: ks: the key set
+ *            state: random number generator state
+ * return: index of the key
+ */
+size_t draw_key(const key_set *ks, unsigned long *state)
+{
+  double u;
+  size_t lo, hi, mid;
+
+  if (ks->cdf == NULL) {
+    return (size_t) ((key_random(state) * (unsigned long) ks->nkeys) >> 31);
+  }
+
+  /* first key whose cumulative chance exceeds u */
+  u = (key_random(state) + key_random(state) / 2147483648.0) / 2147483648.0;
+  lo = 0;
+  hi = ks->nkeys - 1;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (ks->cdf[mid] > u) {
+      hi = mid;
+    }
+    else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
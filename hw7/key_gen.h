@@ -0,0 +1,77 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: key_gen.h
+ *
+ *       Generated key sets for the benchmarks.  A key set is a
+ *       vocabulary of distinct "present" keys, an equal number of
+ *       "absent" keys that are guaranteed different from all of them,
+ *       and a distribution to draw present keys from:
+ *
+ *         zipf         word-like keys drawn with Zipf's law (s = 1),
+ *                      the vocabulary growing with the square root of
+ *                      the stream length as in natural text
+ *         uniform      random 13-character keys drawn uniformly
+ *         adversarial  keys whose hashes all agree in their low 20
+ *                      bits, drawn uniformly
+ *
+ */
+
+#ifndef KEY_GEN_H
+#define KEY_GEN_H
+
+#include <stddef.h>
+
+/* Bytes reserved for each key, including the zero byte. */
+#define KEY_STRIDE 24
+
+/* Low hash bits shared by every adversarial key (present or absent). */
+#define ADVERSARIAL_BITS 20
+
+typedef enum
+{
+    KEYS_ZIPF,
+    KEYS_UNIFORM,
+    KEYS_ADVERSARIAL
+} key_dist;
+
+/*
+ * Key i is at text + i * KEY_STRIDE; keys 0 .. nkeys-1 are present and
+ * nkeys .. 2*nkeys-1 are absent.
+ */
+
+typedef struct
+{
+    key_dist       dist;
+    size_t         nkeys;  /* number of present keys */
+    char          *text;
+    unsigned char *lens;   /* length of each key */
+    double        *cdf;    /* zipf: chance of drawing a key <= i */
+} key_set;
+
+#define KEY_AT(ks, i) ((ks)->text + (size_t) (i) * KEY_STRIDE)
+#define KEY_LEN(ks, i) ((size_t) (ks)->lens[i])
+
+
+/* Return "zipf", "uniform" or "adversarial". */
+const char *key_dist_name(key_dist dist);
+
+/* Return the vocabulary used for a stream of 'ntokens' keys. */
+size_t key_set_size(key_dist dist, size_t ntokens);
+
+/* Generate the key set for a stream of 'ntokens' keys. */
+key_set *create_key_set(key_dist dist, size_t ntokens);
+
+void free_key_set(key_set *ks);
+
+/*
+ * Draw a present key: return its index (0 .. nkeys-1).  'state' is the
+ * caller's random number generator state; any starting value works and
+ * the same value gives the same stream.
+ */
+size_t draw_key(const key_set *ks, unsigned long *state);
+
+/* Step the same generator and return 31 random bits. */
+unsigned long key_random(unsigned long *state);
+
+#endif  /* KEY_GEN_H */
@@ -11,96 +11,200 @@
 #include <stdlib.h>
 #include <string.h>
 #include "hash_table.h"
+#include "tokenizer.h"
+#include "parallel_count.h"
+#include "table_output.h"
+#include "table_image.h"
+#include "word_map.h"
+#include "table_stats.h"
 #include "memcheck.h"
 
-#define MAX_WORD_LENGTH 100
 
 
 void usage(char *progname)
 {
-    fprintf(stderr, "usage: %s filename\n", progname);
+    fprintf(stderr, "usage: %s [-t nthreads] [-k top-k | -s key|count] "
+                    "[-c table|map] [-w plain|fold] [-o save-file] [--stats] "
+                    "filename\n"
+                    "       %s -i saved-file filename\n", progname, progname);
 }
 
-void add_to_hash_table(hash_table *ht, char *key)
+/*
+ * Token callback for -i: print a word with its count in the loaded table.
+ */
+void print_lookup(const char *word, size_t len, void *arg)
 {
-    int v = get_value(ht, key);
-    set_value(ht, key, v + 1);
+    printf("%.*s %d\n", (int)len, word, lookup_value((hash_table *)arg,
+                                                     word, len));
 }
 
 
 int main(int argc, char **argv)
 {
-    int   nwords;
-    FILE *input_file;
-    char  word[MAX_WORD_LENGTH];
-    char  line[MAX_WORD_LENGTH];
-    char *new_word;
+    input_buffer input;
     hash_table *ht;
+    word_map *wm;
+    table_entry *entries;
+    size_t n;
+    int nthreads = 1, topk = 0, sorted = 0, use_map = 0, stats = 0, i;
+    sort_order order = SORT_BY_KEY;
+    word_mode mode = WORDS_PLAIN;
+    char *filename, *save_file = NULL, *load_file = NULL;
+
+    /* Options come first, each followed by its argument. */
+    for (i = 1; i + 1 < argc && argv[i][0] == '-' && argv[i][1] != '\0';
+         i += 2)
+    {
+        if (strcmp(argv[i], "--stats") == 0)
+        {
+            stats = 1;
+            i--;  /* takes no argument */
+        }
+        else if (strcmp(argv[i], "-t") == 0 && atoi(argv[i + 1]) > 0)
+        {
+            nthreads = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-k") == 0 && atoi(argv[i + 1]) > 0)
+        {
+            topk = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 &&
+                 (strcmp(argv[i + 1], "key") == 0 ||
+                  strcmp(argv[i + 1], "count") == 0))
+        {
+            sorted = 1;
+            order = argv[i + 1][0] == 'k' ? SORT_BY_KEY : SORT_BY_COUNT;
+        }
+        else if (strcmp(argv[i], "-c") == 0 &&
+                 (strcmp(argv[i + 1], "table") == 0 ||
+                  strcmp(argv[i + 1], "map") == 0))
+        {
+            use_map = argv[i + 1][0] == 'm';
+        }
+        else if (strcmp(argv[i], "-w") == 0 &&
+                 (strcmp(argv[i + 1], "plain") == 0 ||
+                  strcmp(argv[i + 1], "fold") == 0))
+        {
+            mode = argv[i + 1][0] == 'f' ? WORDS_FOLDED : WORDS_PLAIN;
+        }
+        else if (strcmp(argv[i], "-o") == 0)
+        {
+            save_file = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-i") == 0)
+        {
+            load_file = argv[i + 1];
+        }
+        else
+        {
+            break;
+        }
+    }
 
-    if (argc != 2)
+    if (i != argc - 1 || (topk && sorted) ||
+        (load_file && (topk || sorted || save_file || use_map)) ||
+        (use_map && (save_file || stats)) || (load_file && stats))
     {
         usage(argv[0]);
         exit(1);
     }
-
-    /* Make the hash table. */
-    ht = create_hash_table();
+    filename = argv[i];
 
     /*
-     * Open the input file.  For simplicity, we specify that the
-     * input file has to contain exactly one word per line.
+     * Open the input file ("-" reads standard input).  Words are
+     * separated by any amount of whitespace and may be of any length;
+     * with -w fold, punctuation separates words as well and they are
+     * counted in lower case.
      */
-    input_file = fopen(argv[1], "r");
-
-    if (input_file == NULL)  /* Open failed. */
+    if (open_input(filename, &input) != 0)  /* Open failed. */
     {
         fprintf(stderr, "Input file \"%s\" does not exist! "
-                        "Terminating program.\n", argv[1]);
+                        "Terminating program.\n", filename);
         return 1;
     }
 
-    /* Add the words to the hash table until there are none left. */
-
-    while (fgets(line, MAX_WORD_LENGTH, input_file) != NULL)
+    /*
+     * With -i, the words of the input are looked up in a table saved by
+     * an earlier run, which is mapped and used without being rebuilt.
+     */
+    if (load_file)
     {
-        /* Clear the contents of 'word'. */
-        word[0] = '\0';
-
-        /* Convert the line to a word. */
-        nwords = sscanf(line, "%s", word);
+        if ((ht = load_hash_table(load_file)) == NULL)
+        {
+            fprintf(stderr, "\"%s\" is not a saved hash table! "
+                            "Terminating program.\n", load_file);
+            close_input(&input);
+            return 1;
+        }
+        tokenize_words(input.data, input.size, mode, print_lookup, ht);
+        free_hash_table(ht);
+        close_input(&input);
+        print_memory_leaks();
+        return 0;
+    }
 
-        if (nwords != 1)  /* Conversion failed, e.g. due to a blank line. */
+    /*
+     * With -c map, the words are counted in one thread with the generic
+     * hash map instead.  Its keys point into the input, so the output
+     * is written before the input is closed.
+     */
+    if (use_map)
+    {
+        wm = count_words_map(input.data, input.size, mode);
+        entries = word_map_entries(wm, &n);
+        if (topk || sorted)
         {
-            continue;
+            sort_entries(entries, n, topk ? SORT_BY_COUNT : order, nthreads);
         }
-        else
+        if (topk && (size_t)topk < n)
         {
-            /* Copy the word.  Add 1 for the zero byte at the end. */
-            new_word = (char *)calloc(strlen(word) + 1, sizeof(char));
-
-            if (new_word == NULL)
-            {
-                fprintf(stderr, "Error: memory allocation failed! "
-                                "Terminating program.\n");
-                return 1;
-            }
+            n = topk;
+        }
+        print_entries(entries, n, stdout);
+        free(entries);
+        free_word_map(wm);
+        close_input(&input);
+        print_memory_leaks();
+        return 0;
+    }
 
-            strcpy(new_word, word);
+    /*
+     * Make the hash table by counting the words straight out of the
+     * input, split across 'nthreads' threads.
+     */
+    ht = count_words(input.data, input.size, nthreads, mode);
 
-            /* Add it to the hash table. */
-            add_to_hash_table(ht, new_word);
-        }
+    if (save_file && save_hash_table(ht, save_file) != 0)
+    {
+        fprintf(stderr, "Could not write \"%s\"!\n", save_file);
     }
 
     /* Print out the hash table key/value pairs. */
-    print_hash_table(ht);
+    if (topk)
+    {
+        print_top_k(ht, topk, stdout);
+    }
+    else if (sorted)
+    {
+        print_sorted(ht, order, nthreads, stdout);
+    }
+    else
+    {
+        print_hash_table(ht);
+    }
+
+    /* Statistics go to stderr so they never mix with the counts. */
+    if (stats)
+    {
+        print_table_stats(ht, stderr);
+    }
 
     /* Clean up. */
     free_hash_table(ht);
-    fclose(input_file);
+    close_input(&input);
 
     /* Check for memory leaks. */
-     print_memory_leaks(); 
+    print_memory_leaks();
 
     return 0;
 }
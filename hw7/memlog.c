@@ -0,0 +1,444 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: memlog.c
+ *
+ *       Offline analysis of a memcheck event log (see memcheck.h), as
+ *       written by any program linked with memcheck and run with
+ *       MEMCHECK_LOG=file.  It reports:
+ *
+ *         timeline   the run cut into 'spans' equal spans of time, each
+ *                    with the peak and final live bytes and the rate of
+ *                    allocation, in blocks and megabytes per second
+ *         sites      for each call site, the blocks and bytes allocated
+ *                    and a histogram of how long its blocks lived, by
+ *                    powers of ten from under a microsecond up, with the
+ *                    blocks never freed counted as live
+ *
+ *       The events of several threads are merged in time order.  Blocks
+ *       sampled by memcheck stand for 1/p blocks each, where p is the
+ *       chance a block of their size is sampled, so with sampling the
+ *       figures are estimates.
+ *
+ *       usage: memlog logfile [spans]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hash_map.h"
+#include "memlog_read.h"
+#include "memcheck.h"
+
+/* Number of lifetime classes: under 1 us, 10 us, ... 1 s, and longer. */
+#define NLIFETIMES 8
+
+/* Width of the peak bar on each line of the timeline. */
+#define BAR_WIDTH 20
+
+/* A sum of weighted sizes, which rounding can leave just below zero
+ * when it should be zero. */
+#define NONNEGATIVE(x) ((x) > 0 ? (x) : 0)
+
+/* An allocation event, with its time converted to nanoseconds. */
+typedef struct
+{
+  double time;
+  unsigned long seq;       /* position in the log, to keep ties in order */
+  unsigned long addr;
+  unsigned long old_addr;
+  unsigned long size;
+  int site;                /* index in the merged site array */
+  int op;
+} event;
+
+/* A call site, merged over the threads that used it. */
+typedef struct
+{
+  char *filename;
+  int lineno;
+  double allocs;           /* blocks allocated */
+  double bytes;            /* bytes allocated */
+  double lifetimes[NLIFETIMES];  /* blocks freed, by lifetime class */
+  double live;             /* blocks never freed */
+} site_stats;
+
+/* A live block. */
+typedef struct
+{
+  double born;             /* time of its allocation */
+  double weight;           /* blocks it stands for */
+  unsigned long size;
+  int site;
+} live_block;
+
+/* The activity in one span of the timeline. */
+typedef struct
+{
+  double peak;             /* most bytes live */
+  double live;             /* bytes live at its end */
+  double allocs;           /* blocks and bytes allocated */
+  double bytes;
+} span_stats;
+
+HASH_MAP_DEFINE(block_map, unsigned long, live_block, hash_map_int_hash,
+                hash_map_int_equal)
+
+static const char *lifetime_names[NLIFETIMES] = {
+  "<1us", "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"
+};
+
+
+/* find_site: merged index of a call site, added if new.
+ * arguments: sites, nsites: the merged sites so far (may grow)
+ *            filename, lineno: the site
+ * return: its index
+ */
+static int find_site(site_stats **sites, int *nsites, const char *filename,
+                     int lineno)
+{
+  int i;
+
+  for (i = 0; i < *nsites; i++) {
+    if ((*sites)[i].lineno == lineno &&
+        strcmp((*sites)[i].filename, filename) == 0) {
+      return i;
+    }
+  }
+  *sites = (site_stats *) realloc(*sites,
+                                  (*nsites + 1) * sizeof(site_stats));
+  check_alloc(*sites);
+  memset(&(*sites)[*nsites], 0, sizeof(site_stats));
+  (*sites)[*nsites].filename = (char *) malloc(strlen(filename) + 1);
+  check_alloc((*sites)[*nsites].filename);
+  strcpy((*sites)[*nsites].filename, filename);
+  (*sites)[*nsites].lineno = lineno;
+  return (*nsites)++;
+}
+
+
+/* extract_events: pick the allocation events out of a log's records,
+ * merge its sites, and convert its clock ticks to nanoseconds.
+ * arguments: records, nrecords: the log
+ *            nevents: where to store the number of events
+ *            sites, nsites: where to store the merged sites
+ * return: new array of the events, in log order
+ */
+static event *extract_events(memcheck_event *records, size_t nrecords,
+                             size_t *nevents, site_stats **sites,
+                             int *nsites)
+{
+  event *events = (event *) malloc(nrecords * sizeof(event));
+  int *site_of = NULL;     /* merged index of each site number */
+  size_t nsite_of = 0, i, j, len;
+  unsigned long last_ticks = records[0].time, last_ns = 0;
+  double ns_per_tick = 1;
+  char *name;
+
+  check_alloc(events);
+  *nevents = 0;
+  *sites = NULL;
+  *nsites = 0;
+
+  for (i = 1; i < nrecords; i++) {
+    memcheck_event *r = &records[i];
+
+    switch (r->op) {
+    case MEMLOG_SITE:
+      len = r->size;
+      if (len > (nrecords - i - 1) * sizeof(memcheck_event)) {
+        fprintf(stderr, "The log ends in the middle of a record.\n");
+        exit(1);
+      }
+      name = (char *) malloc(len + 1);
+      check_alloc(name);
+      memcpy(name, &records[i + 1], len);
+      name[len] = '\0';
+      if (r->site >= nsite_of) {
+        j = nsite_of;
+        nsite_of = 2 * (size_t) r->site + 16;
+        site_of = (int *) realloc(site_of, nsite_of * sizeof(int));
+        check_alloc(site_of);
+        for (; j < nsite_of; j++) {
+          site_of[j] = -1;  /* not named yet */
+        }
+      }
+      site_of[r->site] = find_site(sites, nsites, name, (int) r->addr);
+      free(name);
+      /* the name fills the records after this one */
+      i += (len + sizeof(memcheck_event) - 1) / sizeof(memcheck_event);
+      break;
+
+    case MEMLOG_CLOCK:
+      if (r->time > last_ticks) {
+        last_ticks = r->time;
+        last_ns = r->size;
+      }
+      break;
+
+    case MEMLOG_ALLOC:
+    case MEMLOG_FREE:
+    case MEMLOG_REALLOC:
+    case MEMLOG_SAMPLE:
+      if (r->op != MEMLOG_SAMPLE &&
+          (r->site >= nsite_of || site_of[r->site] < 0)) {
+        fprintf(stderr, "Event at unnamed site %u: not a memcheck event "
+                "log.\n", r->site);
+        exit(1);
+      }
+      events[*nevents].time = (double) (r->time - records[0].time);
+      events[*nevents].seq = *nevents;
+      events[*nevents].addr = r->addr;
+      events[*nevents].old_addr = r->old_addr;
+      events[*nevents].size = r->size;
+      events[*nevents].site = r->op == MEMLOG_SAMPLE ? -1
+                                                     : site_of[r->site];
+      events[*nevents].op = (int) r->op;
+      (*nevents)++;
+      break;
+
+    default:
+      fprintf(stderr, "Unknown record %u in the log.\n", r->op);
+      exit(1);
+    }
+  }
+
+  /* the ticks run at the rate between the start and the last clock */
+  if (last_ticks > records[0].time) {
+    ns_per_tick = last_ns / (double) (last_ticks - records[0].time);
+  }
+  for (i = 0; i < *nevents; i++) {
+    events[i].time *= ns_per_tick;
+  }
+  free(site_of);
+  return events;
+}
+
+
+/* compare_events: qsort comparison, by time and then by log order */
+static int compare_events(const void *a, const void *b)
+{
+  const event *x = (const event *) a, *y = (const event *) b;
+
+  if (x->time != y->time) {
+    return x->time < y->time ? -1 : 1;
+  }
+  return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+
+/* compare_sites: qsort comparison, most bytes allocated first */
+static int compare_sites(const void *a, const void *b)
+{
+  const site_stats *x = (const site_stats *) a, *y = (const site_stats *) b;
+
+  return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+
+/* block_weight: blocks a logged block of 'size' bytes stands for, with
+ * one sampled per 'interval' bytes (0 for every block), as memcheck
+ * weights it */
+static double block_weight(unsigned long size, unsigned long interval)
+{
+  if (interval == 0) {
+    return 1;
+  }
+  return 1 / (1 - exp(-(double) size / interval));
+}
+
+
+/* lifetime_class: class of a lifetime of 'ns' nanoseconds */
+static int lifetime_class(double ns)
+{
+  int c = 0;
+  double limit;
+
+  for (limit = 1000; c < NLIFETIMES - 1 && ns >= limit; limit *= 10) {
+    c++;
+  }
+  return c;
+}
+
+
+/* analyze: replay the events in time order.
+ * arguments: events, nevents: the events, sorted by time
+ *            sites: the merged sites, whose counts are filled in
+ *            spans, nspans: the timeline to fill in
+ *            interval: the sample interval at the start of the log
+ *            peak, peak_time: where to store the most bytes ever live
+ *                             and when that was
+ */
+static void analyze(event *events, size_t nevents, site_stats *sites,
+                    span_stats *spans, int nspans, unsigned long interval,
+                    double *peak, double *peak_time)
+{
+  block_map *blocks = block_map_create();
+  double end = nevents > 0 ? events[nevents - 1].time : 0, live = 0, grew;
+  live_block *b, old;
+  size_t i, pos = 0;
+  int s = 0, inserted;
+
+  *peak = *peak_time = 0;
+  for (i = 0; i < nevents; i++) {
+    event *e = &events[i];
+
+    /* spans with no events keep the live bytes of the last one */
+    while (s < nspans - 1 && e->time >= end * (s + 1) / nspans) {
+      spans[++s].peak = live;
+      spans[s].live = live;
+    }
+
+    switch (e->op) {
+    case MEMLOG_ALLOC:
+      b = block_map_put(blocks, &e->addr, &inserted);
+      if (!inserted) {
+        live -= b->size * b->weight;  /* leaked and its address reused */
+      }
+      b->born = e->time;
+      b->weight = block_weight(e->size, interval);
+      b->size = e->size;
+      b->site = e->site;
+      live += b->size * b->weight;
+      sites[e->site].allocs += b->weight;
+      sites[e->site].bytes += b->size * b->weight;
+      spans[s].allocs += b->weight;
+      spans[s].bytes += b->size * b->weight;
+      break;
+
+    case MEMLOG_FREE:
+      b = block_map_get(blocks, &e->addr);
+      if (b != NULL) {
+        live -= b->size * b->weight;
+        sites[b->site].lifetimes[lifetime_class(e->time - b->born)] +=
+          b->weight;
+        block_map_remove(blocks, &e->addr);
+      }
+      break;
+
+    case MEMLOG_REALLOC:
+      b = block_map_get(blocks, &e->old_addr);
+      if (b == NULL) {
+        break;
+      }
+      old = *b;
+      block_map_remove(blocks, &e->old_addr);
+      grew = -(old.size * old.weight);
+      /* as in memcheck, a sampled block is reweighted for its new size */
+      if (old.weight != 1 && interval != 0) {
+        old.weight = block_weight(e->size, interval);
+      }
+      old.size = e->size;
+      grew += old.size * old.weight;
+      live += grew;
+      if (grew > 0) {
+        sites[old.site].bytes += grew;
+        spans[s].bytes += grew;
+      }
+      *block_map_put(blocks, &e->addr, &inserted) = old;
+      break;
+
+    case MEMLOG_SAMPLE:
+      interval = e->size;
+      break;
+    }
+
+    if (live > spans[s].peak) {
+      spans[s].peak = live;
+    }
+    spans[s].live = live;
+    if (live > *peak) {
+      *peak = live;
+      *peak_time = e->time;
+    }
+  }
+  while (s < nspans - 1) {
+    spans[++s].peak = live;
+    spans[s].live = live;
+  }
+
+  /* what is left was never freed */
+  while ((b = (live_block *) block_map_next(blocks, &pos)) != NULL) {
+    sites[b->site].live += b->weight;
+  }
+  block_map_free(blocks);
+}
+
+
+int main(int argc, char **argv)
+{
+  memcheck_event *records;
+  event *events;
+  site_stats *sites;
+  span_stats *spans;
+  size_t nrecords, nevents;
+  int nspans = argc > 2 ? atoi(argv[2]) : 20, nsites, i, j, bar;
+  double peak, peak_time, end, span_ns, allocs = 0, bytes = 0, leaked = 0;
+
+  if (argc < 2 || argc > 3 || nspans < 1) {
+    fprintf(stderr, "usage: %s logfile [spans]\n", argv[0]);
+    return 1;
+  }
+  records = read_log(argv[1], &nrecords);
+  events = extract_events(records, nrecords, &nevents, &sites, &nsites);
+  qsort(events, nevents, sizeof(event), compare_events);
+  spans = (span_stats *) calloc(nspans, sizeof(span_stats));
+  check_alloc(spans);
+  analyze(events, nevents, sites, spans, nspans, records[0].size, &peak,
+          &peak_time);
+
+  end = nevents > 0 ? events[nevents - 1].time : 0;
+  span_ns = end / nspans;
+  for (i = 0; i < nsites; i++) {
+    allocs += sites[i].allocs;
+    bytes += sites[i].bytes;
+    leaked += sites[i].live;
+  }
+  printf("%lu events over %.3f ms: %.0f blocks, %.0f bytes allocated; "
+         "peak %.0f bytes live at %.3f ms; %.0f blocks never freed.\n",
+         (unsigned long) nevents, end / 1e6, allocs, bytes, peak,
+         peak_time / 1e6, leaked);
+  if (records[0].size != 0) {
+    printf("(Estimated from blocks sampled once per %lu bytes.)\n",
+           records[0].size);
+  }
+
+  printf("\n%10s %12s %12s %12s %10s  %s\n", "from ms", "peak bytes",
+         "live at end", "allocs/s", "MB/s", "peak");
+  for (i = 0; i < nspans; i++) {
+    bar = peak > 0 ? (int) (spans[i].peak / peak * BAR_WIDTH + 0.5) : 0;
+    printf("%10.3f %12.0f %12.0f %12.0f %10.1f  ", i * span_ns / 1e6,
+           NONNEGATIVE(spans[i].peak), NONNEGATIVE(spans[i].live),
+           span_ns > 0 ? spans[i].allocs / span_ns * 1e9 : 0,
+           span_ns > 0 ? spans[i].bytes / span_ns * 1e3 : 0);
+    for (j = 0; j < bar; j++) {
+      putchar('#');
+    }
+    putchar('\n');
+  }
+
+  qsort(sites, nsites, sizeof(site_stats), compare_sites);
+  printf("\nBlocks freed after a lifetime of:\n");
+  printf("%10s %12s", "allocs", "bytes");
+  for (j = 0; j < NLIFETIMES; j++) {
+    printf(" %8s", lifetime_names[j]);
+  }
+  printf(" %8s  %s\n", "live", "site");
+  for (i = 0; i < nsites; i++) {
+    printf("%10.0f %12.0f", sites[i].allocs, sites[i].bytes);
+    for (j = 0; j < NLIFETIMES; j++) {
+      printf(" %8.0f", sites[i].lifetimes[j]);
+    }
+    printf(" %8.0f  %s:%d\n", sites[i].live, sites[i].filename,
+           sites[i].lineno);
+    free(sites[i].filename);
+  }
+
+  free(sites);
+  free(spans);
+  free(events);
+  free(records);
+  return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: memlog_read.c
+ *
+ *       Reading memcheck event logs (see memlog_read.h).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "memlog_read.h"
+
+
+/* check_alloc: exit if an allocation failed. */
+void check_alloc(void *p)
+{
+  if (p == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+}
+
+
+/* read_log: read a whole log file.
+ * arguments: filename: the log
+ *            n: where to store the number of records
+ * return: new array of the records
+ */
+memcheck_event *read_log(const char *filename, size_t *n)
+{
+  FILE *f = fopen(filename, "rb");
+  memcheck_event *records;
+  long size;
+
+  if (f == NULL) {
+    perror(filename);
+    exit(1);
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  rewind(f);
+
+  records = (memcheck_event *) malloc(size > 0 ? (size_t) size : 1);
+  check_alloc(records);
+  *n = (size_t) size / sizeof(memcheck_event);
+  if (size < 0 || fread(records, sizeof(memcheck_event), *n, f) != *n ||
+      *n == 0 || records[0].op != MEMLOG_START ||
+      records[0].addr != MEMLOG_MAGIC) {
+    fprintf(stderr, "%s: not a memcheck event log.\n", filename);
+    exit(1);
+  }
+  fclose(f);
+  return records;
+}
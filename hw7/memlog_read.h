@@ -0,0 +1,27 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: memlog_read.h
+ *
+ *       Reading memcheck event logs (see memcheck.h), for the tools
+ *       that analyze or replay them.
+ *
+ */
+
+#ifndef MEMLOG_READ_H
+#define MEMLOG_READ_H
+
+#include <stddef.h>
+#include "memcheck.h"
+
+/* Exit with an error message if an allocation failed (p is NULL). */
+void check_alloc(void *p);
+
+/*
+ * Read the whole log 'filename' and store its number of records in *n.
+ * Exit with an error message if it can't be read or doesn't start with
+ * a MEMLOG_START record.  Return a new array of the records.
+ */
+memcheck_event *read_log(const char *filename, size_t *n);
+
+#endif  /* MEMLOG_READ_H */
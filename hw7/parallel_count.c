@@ -0,0 +1,121 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: parallel_count.c
+ *
+ *       Counting the words of an input buffer with several threads.
+ *       Each worker owns a private hash table, so no locking is needed
+ *       until the tables are merged at the end.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "parallel_count.h"
+#include "tokenizer.h"
+#include "memcheck.h"
+
+/*
+ * One worker's share of the input and the table it counts into.
+ */
+
+typedef struct
+{
+  char *data;        /* start of this worker's chunk */
+  size_t size;       /* length of the chunk */
+  word_mode mode;    /* how to split the chunk into words */
+  hash_table *ht;    /* counts for the chunk */
+  pthread_t thread;
+  int started;       /* 1 if 'thread' is running this job */
+} count_job;
+
+
+/* count_word: token callback that counts one occurrence of a word.
+ * arguments: word, len: the word, pointing into the input
+ *            arg: hash table to count into
+ */
+static void count_word(const char *word, size_t len, void *arg)
+{
+  add_value((hash_table *) arg, word, len, 1);
+}
+
+
+/* count_chunk: thread body that counts one chunk of the input.
+ * arguments: arg: pointer to the count_job to run
+ * return: NULL
+ */
+static void *count_chunk(void *arg)
+{
+  count_job *job = (count_job *) arg;
+  tokenize_words(job->data, job->size, job->mode, count_word, job->ht);
+  return NULL;
+}
+
+
+/* count_words: count words using several threads.
+ * arguments: data, size: the input
+ *            nthreads: number of threads to use (at least 1)
+ *            mode: how to split the input into words
+ * return: pointer to a new hash table holding the counts
+ */
+hash_table *count_words(char *data, size_t size, int nthreads,
+                        word_mode mode)
+{
+  count_job *jobs;
+  hash_table *ht;
+  size_t start, end;
+  int i;
+
+  if (nthreads <= 1 || size < (size_t) nthreads) {
+    ht = create_hash_table();
+    tokenize_words(data, size, mode, count_word, ht);
+    return ht;
+  }
+
+  jobs = (count_job *) calloc(nthreads, sizeof(count_job));
+  if (jobs == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+
+  /* cuts the input into roughly equal chunks, moving each cut forward
+   * to the next whitespace so no word is split */
+  start = 0;
+  for (i = 0; i < nthreads; i++) {
+    end = (i == nthreads - 1) ? size
+        : token_boundary(data, size, size / nthreads * (i + 1));
+    if (end < start) {
+      end = start;
+    }
+    jobs[i].data = data + start;
+    jobs[i].size = end - start;
+    jobs[i].mode = mode;
+    jobs[i].ht = create_hash_table();
+    start = end;
+  }
+
+  /* the calling thread takes the first chunk itself */
+  for (i = 1; i < nthreads; i++) {
+    jobs[i].started =
+      pthread_create(&jobs[i].thread, NULL, count_chunk, &jobs[i]) == 0;
+  }
+  count_chunk(&jobs[0]);
+
+  /* runs any chunk whose thread couldn't be started, then merges */
+  ht = jobs[0].ht;
+  for (i = 1; i < nthreads; i++) {
+    if (jobs[i].started) {
+      pthread_join(jobs[i].thread, NULL);
+    }
+    else {
+      count_chunk(&jobs[i]);
+    }
+    merge_hash_table(ht, jobs[i].ht);
+  }
+
+  free(jobs);
+  return ht;
+}
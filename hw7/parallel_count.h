@@ -0,0 +1,27 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: parallel_count.h
+ *
+ *       Counting the words of an input buffer with several threads.
+ *
+ */
+
+#ifndef PARALLEL_COUNT_H
+#define PARALLEL_COUNT_H
+
+#include <stddef.h>
+#include "hash_table.h"
+#include "tokenizer.h"
+
+/*
+ * Count the words in 'size' bytes at 'data', split as 'mode' says, and
+ * return a new hash table mapping each word to its count.  The input is
+ * split at token boundaries into 'nthreads' chunks; each thread counts
+ * its chunk into a table of its own and the tables are merged at the
+ * end, so the result is the same for any number of threads.
+ */
+hash_table *count_words(char *data, size_t size, int nthreads,
+                        word_mode mode);
+
+#endif  /* PARALLEL_COUNT_H */
@@ -0,0 +1,86 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: perf_counters.c
+ *
+ *       Cache-miss counting through Linux perf events.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <unistd.h>
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+
+/* open_cache_miss_counter: open a user-space cache-miss counter.
+ * return: counter handle, or -1 if the counter isn't available
+ */
+int open_cache_miss_counter(void)
+{
+#ifdef __linux__
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+
+/* start_counter: zero a counter and start it.
+ * arguments: counter: handle from open_cache_miss_counter()
+ */
+void start_counter(int counter)
+{
+#ifdef __linux__
+  if (counter >= 0) {
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+
+/* stop_counter: stop a counter and read it.
+ * arguments: counter: handle from open_cache_miss_counter()
+ * return: events counted since start_counter(), or 0 if unavailable
+ */
+uint64_t stop_counter(int counter)
+{
+  uint64_t count = 0;
+#ifdef __linux__
+  if (counter >= 0) {
+    ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(counter, &count, sizeof(count)) != sizeof(count)) {
+      count = 0;
+    }
+  }
+#endif
+  return count;
+}
+
+
+/* close_counter: release a counter.
+ * arguments: counter: handle from open_cache_miss_counter()
+ */
+void close_counter(int counter)
+{
+  if (counter >= 0) {
+    close(counter);
+  }
+}
@@ -0,0 +1,31 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: perf_counters.h
+ *
+ *       Minimal access to the CPU's cache-miss counter for benchmarks.
+ *       On systems without perf events (or where they aren't permitted)
+ *       the counter simply reports itself unavailable.
+ *
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+/*
+ * Open a counter of last-level cache misses for the calling thread
+ * (user space only).  Return a handle, or -1 if counting isn't possible.
+ */
+int open_cache_miss_counter(void);
+
+/* Zero the counter and start counting. */
+void start_counter(int counter);
+
+/* Stop counting and return the number of events since start_counter(). */
+uint64_t stop_counter(int counter);
+
+void close_counter(int counter);
+
+#endif  /* PERF_COUNTERS_H */
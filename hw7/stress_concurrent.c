@@ -0,0 +1,225 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: stress_concurrent.c
+ *
+ *       Stress test and benchmark for the concurrent hash table.  Every
+ *       thread hammers one shared table with a random mix of additions
+ *       (of -2 to +2, so counts go negative and through zero) and lookups
+ *       on a shared key set; the final counts are checked against a
+ *       sequential replay into the ordinary hash table.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "concurrent_hash_table.h"
+#include "hash_table.h"
+#include "bench_timer.h"
+#include "key_gen.h"
+#include "memcheck.h"
+
+/* Percentage of operations that are lookups rather than additions. */
+#define LOOKUP_PERCENT 10
+
+/* The amount an operation adds, from its random bits: -2 to 2. */
+#define DELTA(r) ((long) ((r) >> 8) % 5 - 2)
+
+typedef struct
+{
+  concurrent_hash_table *cht;
+  char (*keys)[16];  /* the shared key set */
+  long nkeys;
+  long nops;         /* operations for this thread */
+  unsigned long seed;
+  pthread_t thread;
+} stress_job;
+
+
+/* hammer: thread body doing 'nops' random operations on the table.
+ * arguments: arg: pointer to this thread's stress_job
+ * return: NULL
+ */
+static void *hammer(void *arg)
+{
+  stress_job *job = (stress_job *) arg;
+  unsigned long state = job->seed, r;
+  const char *key;
+  long i;
+
+  for (i = 0; i < job->nops; i++) {
+    r = key_random(&state);
+    key = job->keys[r % job->nkeys];
+    if ((long) (r >> 16) % 100 < LOOKUP_PERCENT) {
+      chash_get(job->cht, key, strlen(key));
+    }
+    else {
+      chash_add(job->cht, key, strlen(key), DELTA(r));
+    }
+  }
+  return NULL;
+}
+
+
+/* replay: do a thread's additions sequentially into a hash table.
+ * arguments: job: the thread whose operations to replay
+ *            ht: reference table to count into
+ */
+static void replay(stress_job *job, hash_table *ht)
+{
+  unsigned long state = job->seed, r;
+  const char *key;
+  long i;
+
+  for (i = 0; i < job->nops; i++) {
+    r = key_random(&state);
+    key = job->keys[r % job->nkeys];
+    if ((long) (r >> 16) % 100 >= LOOKUP_PERCENT) {
+      add_value(ht, key, strlen(key), (int) DELTA(r));
+    }
+  }
+}
+
+
+/* count_node: for_each_node callback counting the keys of a table. */
+static void count_node(node *n, void *arg)
+{
+  (*(long *) arg)++;
+}
+
+
+/* check_signs: single-threaded checks of negative values, across a
+ * resize.
+ * return: the number of mismatches
+ */
+static long check_signs(void)
+{
+  concurrent_hash_table *cht = create_concurrent_hash_table(0);
+  char key[16];
+  long errors = 0, k;
+
+  chash_add(cht, "a", 1, -1);
+  errors += chash_add(cht, "a", 1, 1) != 0;
+  errors += chash_add(cht, "a", 1, -3) != -3;
+  errors += chash_get(cht, "a", 1) != -3;
+
+  /* enough keys to resize the table several times */
+  for (k = 0; k < 1000; k++) {
+    sprintf(key, "k%ld", k);
+    chash_add(cht, key, strlen(key), -k);
+  }
+  errors += chash_add(cht, "a", 1, 1) != -2;
+  for (k = 0; k < 1000; k++) {
+    sprintf(key, "k%ld", k);
+    errors += chash_get(cht, key, strlen(key)) != -k;
+  }
+  free_concurrent_hash_table(cht);
+  return errors;
+}
+
+
+int main(int argc, char **argv)
+{
+  int nthreads, i;
+  long nkeys = 20000, nops = 1000000, k, errors = 0, distinct = 0;
+  stress_job *jobs;
+  char (*keys)[16];
+  concurrent_hash_table *cht;
+  hash_table *ht;
+  double start, elapsed;
+
+  nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (nthreads < 2) {
+    nthreads = 2;  /* still exercise the concurrent paths */
+  }
+  for (i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-t") == 0) {
+      nthreads = atoi(argv[i + 1]);
+    }
+    else if (strcmp(argv[i], "-k") == 0) {
+      nkeys = atol(argv[i + 1]);
+    }
+    else if (strcmp(argv[i], "-n") == 0) {
+      nops = atol(argv[i + 1]);
+    }
+  }
+  if (i != argc || nthreads < 1 || nkeys < 1 || nops < 0) {
+    fprintf(stderr, "usage: %s [-t nthreads] [-k nkeys] [-n ops-per-thread]\n",
+            argv[0]);
+    return 1;
+  }
+
+  keys = (char (*)[16]) malloc(nkeys * sizeof(*keys));
+  jobs = (stress_job *) malloc(nthreads * sizeof(stress_job));
+  if (keys == NULL || jobs == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    return 1;
+  }
+  for (k = 0; k < nkeys; k++) {
+    sprintf(keys[k], "key%ld", k);
+  }
+
+  /* starts small so the run goes through many cooperative resizes */
+  cht = create_concurrent_hash_table(0);
+  for (i = 0; i < nthreads; i++) {
+    jobs[i].cht = cht;
+    jobs[i].keys = keys;
+    jobs[i].nkeys = nkeys;
+    jobs[i].nops = nops;
+    jobs[i].seed = 12345 + 7919 * (unsigned long) i;
+  }
+
+  start = bench_seconds();
+  for (i = 0; i < nthreads; i++) {
+    if (pthread_create(&jobs[i].thread, NULL, hammer, &jobs[i]) != 0) {
+      fprintf(stderr, "Error creating thread.\n");
+      return 1;
+    }
+  }
+  for (i = 0; i < nthreads; i++) {
+    pthread_join(jobs[i].thread, NULL);
+  }
+  elapsed = bench_seconds() - start;
+  printf("concurrent: %d threads, %ld ops in %.3f s (%.1f Mops/s)\n",
+         nthreads, nthreads * nops, elapsed,
+         nthreads * nops / elapsed / 1e6);
+
+  /* sequential reference */
+  ht = create_hash_table();
+  start = bench_seconds();
+  for (i = 0; i < nthreads; i++) {
+    replay(&jobs[i], ht);
+  }
+  elapsed = bench_seconds() - start;
+  printf("sequential reference: %.3f s\n", elapsed);
+
+  for_each_node(ht, count_node, &distinct);
+  errors = check_signs();
+  for (k = 0; k < nkeys; k++) {
+    if (chash_get(cht, keys[k], strlen(keys[k])) != get_value(ht, keys[k])) {
+      errors++;
+    }
+  }
+  if ((long) chash_count(cht) != distinct) {
+    fprintf(stderr, "Table holds %lu keys, expected %ld!\n",
+            (unsigned long) chash_count(cht), distinct);
+    errors++;
+  }
+
+  free_hash_table(ht);
+  free_concurrent_hash_table(cht);
+  free(jobs);
+  free(keys);
+
+  if (errors != 0) {
+    printf("Stress test failed: %ld mismatches!\n", errors);
+    return 1;
+  }
+  printf("Stress test succeeded!\n");
+  return 0;
+}
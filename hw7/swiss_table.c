@@ -0,0 +1,309 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: swiss_table.c
+ *
+ *       Implementation of the control-byte probed table.
+ *
+ *       A key's hash is split in two: the high bits (h1) choose the
+ *       group where probing starts and the low 7 bits (h2) are stored in
+ *       the control byte.  A probe loads a group's 16 control bytes,
+ *       compares all of them with h2 at once (SSE2 when available), and
+ *       only looks at the entries whose byte matched.  A group with an
+ *       empty slot ends the probe, so most misses never touch an entry.
+ *
+ *       A removed key's slot can only be marked empty if its group
+ *       already has an empty slot (no probe ever went on past such a
+ *       group); otherwise it becomes a tombstone.  New keys reuse
+ *       tombstones, and the rest are swept out when the table next runs
+ *       out of empty slots.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "swiss_table.h"
+#include "hash_table.h"
+#include "memcheck.h"
+
+/* Initial number of slots. */
+#define INITIAL_CAPACITY 16
+
+#define h1(hash) ((size_t) ((hash) >> 7))
+#define h2(hash) ((signed char) ((hash) & 0x7F))
+
+
+/*** Group matching. ***/
+
+/* match_byte: find the control bytes of a group equal to 'b'.
+ * arguments: ctrl: first control byte of the group
+ *            b: byte to look for
+ * return: bit i is set if ctrl[i] == b
+ */
+static unsigned match_byte(const signed char *ctrl, signed char b)
+{
+#ifdef __SSE2__
+  __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+  return (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(group,
+                                                     _mm_set1_epi8(b)));
+#else
+  unsigned mask = 0;
+  int i;
+  for (i = 0; i < SWISS_GROUP; i++) {
+    if (ctrl[i] == b) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+
+/* match_free: find the empty or deleted slots of a group.
+ * arguments: ctrl: first control byte of the group
+ * return: bit i is set if slot i holds no key
+ */
+static unsigned match_free(const signed char *ctrl)
+{
+#ifdef __SSE2__
+  /* exactly the bytes that hold no key have their top bit set */
+  return (unsigned) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+#else
+  unsigned mask = 0;
+  int i;
+  for (i = 0; i < SWISS_GROUP; i++) {
+    if (!SWISS_FULL(ctrl[i])) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+
+/*** Table utilities. ***/
+
+/* alloc_slots: give a table empty slot arrays.
+ * arguments: st: table whose arrays to allocate
+ *            capacity: number of slots
+ */
+static void alloc_slots(swiss_table *st, size_t capacity)
+{
+  st->capacity = capacity;
+  st->count = 0;
+  st->growth_left = capacity / 8 * 7;
+  st->ctrl = (signed char *) malloc(capacity);
+  st->entries = (swiss_entry *) malloc(capacity * sizeof(swiss_entry));
+  if (st->ctrl == NULL || st->entries == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  memset(st->ctrl, SWISS_EMPTY, capacity);
+}
+
+
+/* find_free: find the slot a new key with this hash should go into.
+ * arguments: st: the table, which must have an empty slot
+ *            hash: hash of the new key
+ * return: index of the first empty or deleted slot on the key's probe
+ *         sequence
+ */
+static size_t find_free(swiss_table *st, uint64_t hash)
+{
+  size_t ngroups = st->capacity / SWISS_GROUP;
+  size_t g = h1(hash) & (ngroups - 1), step;
+  unsigned free_slots;
+
+  for (step = 1; ; step++) {
+    free_slots = match_free(st->ctrl + g * SWISS_GROUP);
+    if (free_slots != 0) {
+      return g * SWISS_GROUP + __builtin_ctz(free_slots);
+    }
+    /* triangular steps visit every group of a power-of-two table */
+    g = (g + step) & (ngroups - 1);
+  }
+}
+
+
+/* rehash: move every entry into new arrays, dropping the tombstones.
+ *         The stored hashes are reused, so no key is read.
+ * arguments: st: the table to rehash
+ *            capacity: number of slots in the new arrays
+ */
+static void rehash(swiss_table *st, size_t capacity)
+{
+  signed char *old_ctrl = st->ctrl;
+  swiss_entry *old_entries = st->entries;
+  size_t old_capacity = st->capacity, i, j;
+
+  alloc_slots(st, capacity);
+  for (i = 0; i < old_capacity; i++) {
+    if (SWISS_FULL(old_ctrl[i])) {
+      j = find_free(st, old_entries[i].hash);
+      st->ctrl[j] = old_ctrl[i];
+      st->entries[j] = old_entries[i];
+      st->count++;
+      st->growth_left--;
+    }
+  }
+  free(old_ctrl);
+  free(old_entries);
+}
+
+
+/* find_key: probe for a key.
+ * arguments: st: the table
+ *            key, len: the key
+ *            hash: hash of the key
+ * return: pointer to the key's entry, or NULL if it isn't in the table
+ */
+static swiss_entry *find_key(swiss_table *st, const char *key, size_t len,
+                             uint64_t hash)
+{
+  size_t ngroups = st->capacity / SWISS_GROUP;
+  size_t g = h1(hash) & (ngroups - 1), step;
+  const signed char *group;
+  swiss_entry *e;
+  unsigned match;
+
+  for (step = 1; step <= ngroups; step++) {
+    group = st->ctrl + g * SWISS_GROUP;
+    for (match = match_byte(group, h2(hash)); match != 0;
+         match &= match - 1) {
+      e = &st->entries[g * SWISS_GROUP + __builtin_ctz(match)];
+      if (e->hash == hash && e->len == len && memcmp(e->key, key, len) == 0) {
+        return e;
+      }
+    }
+    if (match_byte(group, SWISS_EMPTY) != 0) {
+      return NULL;
+    }
+    g = (g + step) & (ngroups - 1);
+  }
+  return NULL;
+}
+
+
+/* create_swiss_table: create a new, empty table.
+ * return: pointer to the table
+ */
+swiss_table *create_swiss_table(void)
+{
+  swiss_table *st;
+  st = (swiss_table *) malloc(sizeof(swiss_table));
+  if (st == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  alloc_slots(st, INITIAL_CAPACITY);
+  return st;
+}
+
+
+/* free_swiss_table: free a table and all its keys.
+ * arguments: st: pointer to the table to be freed
+ */
+void free_swiss_table(swiss_table *st)
+{
+  size_t i;
+  for (i = 0; i < st->capacity; i++) {
+    if (SWISS_FULL(st->ctrl[i])) {
+      free(st->entries[i].key);
+    }
+  }
+  free(st->ctrl);
+  free(st->entries);
+  free(st);
+}
+
+
+/* swiss_get_value: look up a key.
+ * arguments: st: the table
+ *            key, len: the key
+ * return: the value at the key, or 0 if the key isn't in the table
+ */
+int swiss_get_value(swiss_table *st, const char *key, size_t len)
+{
+  swiss_entry *e = find_key(st, key, len, hash64(key, len));
+  return e != NULL ? e->value : 0;
+}
+
+
+/* swiss_add_value: add to the value at a key, inserting it if needed.
+ * arguments: st: the table
+ *            key, len: the key
+ *            delta: amount to add
+ * return: the new value at the key
+ */
+int swiss_add_value(swiss_table *st, const char *key, size_t len, int delta)
+{
+  uint64_t hash = hash64(key, len);
+  swiss_entry *e;
+  size_t i;
+
+  e = find_key(st, key, len, hash);
+  if (e != NULL) {
+    e->value += delta;
+    return e->value;
+  }
+
+  if (st->growth_left == 0) {
+    /* out of empty slots: if tombstones take up much of the table,
+     * sweeping them out is enough */
+    rehash(st, st->count < st->capacity / 16 * 7 ? st->capacity
+                                                  : st->capacity * 2);
+  }
+  i = find_free(st, hash);
+  /* reusing a tombstone uses up no empty slot */
+  if (st->ctrl[i] == SWISS_EMPTY) {
+    st->growth_left--;
+  }
+  e = &st->entries[i];
+  e->hash = hash;
+  e->len = len;
+  e->value = delta;
+  e->key = (char *) malloc(len + 1);
+  if (e->key == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  memcpy(e->key, key, len);
+  e->key[len] = '\0';
+  st->ctrl[i] = h2(hash);
+  st->count++;
+  return delta;
+}
+
+
+/* swiss_remove: remove a key.
+ * arguments: st: the table
+ *            key, len: the key
+ * return: 1 if the key was removed, 0 if it wasn't in the table
+ */
+int swiss_remove(swiss_table *st, const char *key, size_t len)
+{
+  swiss_entry *e = find_key(st, key, len, hash64(key, len));
+  size_t i;
+
+  if (e == NULL) {
+    return 0;
+  }
+  i = e - st->entries;
+  free(e->key);
+  st->count--;
+  if (match_byte(st->ctrl + i / SWISS_GROUP * SWISS_GROUP, SWISS_EMPTY)
+      != 0) {
+    st->ctrl[i] = SWISS_EMPTY;  /* no probe ever passed this group */
+    st->growth_left++;
+  }
+  else {
+    st->ctrl[i] = SWISS_DELETED;
+  }
+  return 1;
+}
@@ -0,0 +1,84 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: swiss_table.h
+ *
+ *       An open-addressed string-keyed table probed with a control byte
+ *       per slot ("Swiss table" layout).  Each full slot's control byte
+ *       holds 7 bits of the key's hash, and 16 control bytes are compared
+ *       at once, so most non-matching slots are rejected without reading
+ *       the entry or the key.
+ *
+ */
+
+#ifndef SWISS_TABLE_H
+#define SWISS_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of slots whose control bytes are compared at once. */
+#define SWISS_GROUP 16
+
+/*
+ * A full slot.  The hash is kept so growing the table never rehashes a
+ * key.
+ */
+
+typedef struct
+{
+    uint64_t hash;
+    char    *key;   /* null-terminated copy owned by the table */
+    size_t   len;
+    int      value;
+} swiss_entry;
+
+/*
+ * ctrl[i] describes slot i: SWISS_EMPTY, SWISS_DELETED (a removed key's
+ * tombstone, which probes step over), or (for a full slot) the low 7
+ * bits of the key's hash.  Slots are grouped into aligned runs of
+ * SWISS_GROUP.
+ */
+
+typedef struct
+{
+    size_t       capacity;     /* number of slots: a power of two >= 16 */
+    size_t       count;        /* number of full slots */
+    size_t       growth_left;  /* inserts into empty slots left before
+                                  the table grows or is compacted */
+    signed char *ctrl;
+    swiss_entry *entries;
+} swiss_table;
+
+#define SWISS_EMPTY ((signed char) -128)
+#define SWISS_DELETED ((signed char) -2)
+
+/* Whether a control byte marks a full slot. */
+#define SWISS_FULL(c) ((c) >= 0)
+
+
+swiss_table *create_swiss_table(void);
+
+void free_swiss_table(swiss_table *st);
+
+/*
+ * Look up the 'len'-byte key at 'key'.  Return its value, or 0 if it is
+ * not in the table.
+ */
+int swiss_get_value(swiss_table *st, const char *key, size_t len);
+
+/*
+ * Add 'delta' to the value at the 'len'-byte key at 'key', inserting a
+ * copy of the key if it's new.  Return the new value.
+ */
+int swiss_add_value(swiss_table *st, const char *key, size_t len, int delta);
+
+/*
+ * Remove the 'len'-byte key at 'key'.  Return 1 if it was in the table
+ * and 0 if it wasn't.  Tombstones are cleared when the table runs out of
+ * empty slots: if they make up much of the table it is rehashed at the
+ * same size instead of growing.
+ */
+int swiss_remove(swiss_table *st, const char *key, size_t len);
+
+#endif  /* SWISS_TABLE_H */
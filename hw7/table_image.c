@@ -0,0 +1,286 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_image.c
+ *
+ *       Saving hash tables to, and mapping them from, image files.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "table_image.h"
+#include "memcheck.h"
+
+/* Pieces of a mapped image. */
+#define HEADER(image)  ((const image_header *) (image))
+#define BUCKETS(image) ((const uint64_t *) (HEADER(image) + 1))
+#define ENTRIES(image) \
+  ((const image_entry *) (BUCKETS(image) + HEADER(image)->nslots + 1))
+#define BLOB(image)    ((const char *) (ENTRIES(image) + HEADER(image)->count))
+
+
+/*** Saving. ***/
+
+/*
+ * State for filling in an image: one cursor per slot into the entry
+ * array, and a cursor into the blob.
+ */
+
+typedef struct
+{
+  uint64_t nslots;
+  uint64_t *bucket;
+  uint64_t *fill;     /* next free entry of each slot */
+  image_entry *entry;
+  char *blob;
+  uint64_t blob_used;
+} image_builder;
+
+
+/* count_node: for_each_node callback counting a node's slot and key */
+static void count_node(node *n, void *arg)
+{
+  image_builder *b = (image_builder *) arg;
+  b->bucket[(n->hash & (b->nslots - 1)) + 1]++;
+  b->blob_used += n->len + 1;
+}
+
+
+/* place_node: for_each_node callback copying a node into the image */
+static void place_node(node *n, void *arg)
+{
+  image_builder *b = (image_builder *) arg;
+  image_entry *e = &b->entry[b->fill[n->hash & (b->nslots - 1)]++];
+
+  e->hash = n->hash;
+  e->key_off = b->blob_used;
+  e->len = n->len;
+  e->value = n->value;
+  memcpy(b->blob + b->blob_used, n->key, n->len + 1);
+  b->blob_used += n->len + 1;
+}
+
+
+/* save_hash_table: write a table to an image file.
+ * arguments: ht: the table
+ *            filename: file to create or overwrite
+ * return: 0 on success, -1 on failure
+ */
+int save_hash_table(hash_table *ht, const char *filename)
+{
+  image_builder b;
+  image_header h;
+  uint64_t i, blob_size;
+  size_t head_size;
+  char *mem;
+  FILE *fp;
+  int ok;
+
+  /* slots are sized to keep about one key per slot */
+  for (b.nslots = 1; b.nslots < ht->count; b.nslots *= 2) {
+  }
+
+  /* first pass: how many entries each slot gets, and the key bytes */
+  b.bucket = (uint64_t *) calloc(b.nslots + 1, sizeof(uint64_t));
+  b.fill = (uint64_t *) malloc((b.nslots + 1) * sizeof(uint64_t));
+  if (b.bucket == NULL || b.fill == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  b.blob_used = 0;
+  for_each_node(ht, count_node, &b);
+  for (i = 0; i < b.nslots; i++) {
+    b.bucket[i + 1] += b.bucket[i];
+  }
+  memcpy(b.fill, b.bucket, (b.nslots + 1) * sizeof(uint64_t));
+
+  /* second pass: entries grouped by slot, keys packed in the blob
+   * (padded so the file size stays a multiple of 8) */
+  blob_size = (b.blob_used + 7) & ~(uint64_t) 7;
+  head_size = ht->count * sizeof(image_entry) + blob_size;
+  mem = (char *) calloc(head_size + 1, 1);
+  if (mem == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  b.entry = (image_entry *) mem;
+  b.blob = mem + ht->count * sizeof(image_entry);
+  b.blob_used = 0;
+  for_each_node(ht, place_node, &b);
+
+  memcpy(h.magic, IMAGE_MAGIC, sizeof(h.magic));
+  h.nslots = b.nslots;
+  h.count = ht->count;
+  h.blob_size = blob_size;
+  h.file_size = sizeof(h) + (b.nslots + 1) * sizeof(uint64_t) + head_size;
+
+  ok = 0;
+  if ((fp = fopen(filename, "wb")) != NULL) {
+    ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+         fwrite(b.bucket, sizeof(uint64_t), b.nslots + 1, fp)
+           == b.nslots + 1 &&
+         fwrite(mem, 1, head_size, fp) == head_size;
+    ok = (fclose(fp) == 0) && ok;
+  }
+
+  free(mem);
+  free(b.fill);
+  free(b.bucket);
+  return ok ? 0 : -1;
+}
+
+
+/*** Loading. ***/
+
+/* image_valid: check that a mapped file is a whole table image.  The
+ * sizes in the header must add up to the file's, the buckets must run
+ * in order within the entries, and every key must lie in the blob and
+ * end with its zero byte, so that searching never leaves the mapping.
+ * arguments: image: the mapping
+ *            size: size of the file
+ * return: 1 if the image is valid, 0 if not
+ */
+static int image_valid(const void *image, uint64_t size)
+{
+  const image_header *h = HEADER(image);
+  const uint64_t *bucket = BUCKETS(image);
+  const image_entry *e;
+  uint64_t i;
+
+  if (memcmp(h->magic, IMAGE_MAGIC, sizeof(h->magic)) != 0 ||
+      h->file_size != size || h->nslots == 0 ||
+      (h->nslots & (h->nslots - 1)) != 0) {
+    return 0;
+  }
+
+  /* each term is below the file size, so the sum can't overflow */
+  if (h->nslots >= size / sizeof(uint64_t) ||
+      h->count > size / sizeof(image_entry) || h->blob_size > size ||
+      sizeof(image_header) + (h->nslots + 1) * sizeof(uint64_t) +
+      h->count * sizeof(image_entry) + h->blob_size != size) {
+    return 0;
+  }
+
+  if (bucket[h->nslots] > h->count) {
+    return 0;
+  }
+  for (i = 0; i < h->nslots; i++) {
+    if (bucket[i] > bucket[i + 1]) {
+      return 0;
+    }
+  }
+  for (i = 0, e = ENTRIES(image); i < h->count; i++, e++) {
+    if (e->key_off >= h->blob_size || e->len >= h->blob_size - e->key_off ||
+        BLOB(image)[e->key_off + e->len] != '\0') {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+/* load_hash_table: map an image file as a read-only table.
+ * arguments: filename: image file written by save_hash_table()
+ * return: pointer to the table, or NULL on failure
+ */
+hash_table *load_hash_table(const char *filename)
+{
+  const image_header *h;
+  struct stat st;
+  hash_table *ht;
+  void *image;
+  int fd;
+
+  if ((fd = open(filename, O_RDONLY)) < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(image_header)) {
+    close(fd);
+    return NULL;
+  }
+  image = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    return NULL;
+  }
+
+  h = HEADER(image);
+  if (!image_valid(image, (uint64_t) st.st_size)) {
+    munmap(image, (size_t) st.st_size);
+    return NULL;
+  }
+
+  ht = (hash_table *) calloc(1, sizeof(hash_table));
+  if (ht == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  ht->count = (size_t) h->count;
+  ht->image = image;
+  ht->image_size = (size_t) st.st_size;
+  return ht;
+}
+
+
+/* unmap_image: release a mapped image.
+ * arguments: image, size: the mapping
+ */
+void unmap_image(const void *image, size_t size)
+{
+  munmap((void *) image, size);
+}
+
+
+/* image_find: search a mapped image for a key.
+ * arguments: image: the mapping
+ *            key, len: the key
+ *            hash: hash64() of the key
+ * return: the key's entry, or NULL if it isn't in the image
+ */
+const image_entry *image_find(const void *image, const char *key,
+                              size_t len, uint64_t hash)
+{
+  const uint64_t *bucket = BUCKETS(image);
+  const image_entry *e, *end;
+  uint64_t b = hash & (HEADER(image)->nslots - 1);
+
+  for (e = ENTRIES(image) + bucket[b], end = ENTRIES(image) + bucket[b + 1];
+       e < end; e++) {
+    if (e->hash == hash && e->len == len &&
+        memcmp(BLOB(image) + e->key_off, key, len) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+
+/* image_for_each: visit every key of a mapped image.
+ * arguments: image: the mapping
+ *            fn: called with a temporary node for each key
+ *            arg: passed through to 'fn'
+ */
+void image_for_each(const void *image, void (*fn)(node *n, void *arg),
+                    void *arg)
+{
+  const image_entry *e = ENTRIES(image);
+  uint64_t i;
+  node n;
+
+  for (i = 0; i < HEADER(image)->count; i++, e++) {
+    n.key = (char *) BLOB(image) + e->key_off;
+    n.len = (size_t) e->len;
+    n.hash = e->hash;
+    n.value = (int) e->value;
+    n.next = NULL;
+    fn(&n, arg);
+  }
+}
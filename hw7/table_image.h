@@ -0,0 +1,76 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_image.h
+ *
+ *       On-disk format for hash tables.  A saved table is one flat file
+ *       that is mapped read-only and searched in place: it contains no
+ *       pointers, only offsets, so loading it needs no parsing and no
+ *       per-key allocation.
+ *
+ *       Layout (native byte order, every field 8-byte aligned):
+ *
+ *         image_header
+ *         uint64_t bucket[nslots + 1]   entries of slot b are
+ *                                       entry[bucket[b]] .. entry[bucket[b+1]-1]
+ *         image_entry entry[count]
+ *         char blob[blob_size]          every key followed by a zero byte
+ *
+ */
+
+#ifndef TABLE_IMAGE_H
+#define TABLE_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_table.h"
+
+#define IMAGE_MAGIC "HTIMAGE1"
+
+typedef struct
+{
+    char     magic[8];   /* IMAGE_MAGIC, without its zero byte */
+    uint64_t nslots;     /* a power of two */
+    uint64_t count;      /* number of entries */
+    uint64_t blob_size;  /* bytes of key text */
+    uint64_t file_size;  /* total size, for checking the file is whole */
+} image_header;
+
+typedef struct
+{
+    uint64_t hash;     /* hash64() of the key */
+    uint64_t key_off;  /* offset of the key in the blob */
+    uint64_t len;      /* length of the key */
+    int64_t  value;
+} image_entry;
+
+
+/*
+ * Write the table to 'filename' in image format.  Return 0 on success,
+ * -1 if the file couldn't be written.
+ */
+int save_hash_table(hash_table *ht, const char *filename);
+
+/*
+ * Map a saved table.  The result is a read-only hash_table: get_value(),
+ * print_hash_table() and the other read operations work on it directly,
+ * while operations that change it are an error.  Return NULL if the file
+ * can't be mapped or isn't a table image.
+ */
+hash_table *load_hash_table(const char *filename);
+
+/* Release the mapping behind a loaded table. */
+void unmap_image(const void *image, size_t size);
+
+/*
+ * Find a key in a mapped image.  Return its entry, or NULL if the key
+ * isn't there.
+ */
+const image_entry *image_find(const void *image, const char *key,
+                              size_t len, uint64_t hash);
+
+/* Call 'fn' on every key of a mapped image, presented as a node. */
+void image_for_each(const void *image, void (*fn)(node *n, void *arg),
+                    void *arg);
+
+#endif  /* TABLE_IMAGE_H */
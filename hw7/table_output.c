@@ -0,0 +1,433 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_output.c
+ *
+ *       Writing out hash table contents.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "table_output.h"
+#include "memcheck.h"
+
+
+/*** Buffered writer. ***/
+
+/* out_open: start buffering output for a stream.
+ * arguments: out: writer to set up
+ *            fp: stream to write to
+ */
+void out_open(out_buffer *out, FILE *fp)
+{
+  out->fp = fp;
+  out->used = 0;
+  out->buf = (char *) malloc(OUT_BUFFER_SIZE);
+  if (out->buf == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+}
+
+
+/* out_flush: write the buffered bytes out.
+ * arguments: out: the writer
+ */
+static void out_flush(out_buffer *out)
+{
+  fwrite(out->buf, 1, out->used, out->fp);
+  out->used = 0;
+}
+
+
+/* out_pair: write a "key value" line.
+ * arguments: out: the writer
+ *            key, len: the key
+ *            value: the value
+ */
+void out_pair(out_buffer *out, const char *key, size_t len, int value)
+{
+  char digits[16];
+  int ndigits = 0;
+  unsigned long v = value < 0 ? -(unsigned long) value : (unsigned long) value;
+
+  /* room for the key, a space, a sign, digits and a newline */
+  if (out->used + len + sizeof(digits) + 3 > OUT_BUFFER_SIZE) {
+    out_flush(out);
+    if (len + sizeof(digits) + 3 > OUT_BUFFER_SIZE) { /* a huge key */
+      fwrite(key, 1, len, out->fp);
+      len = 0;
+    }
+  }
+  memcpy(out->buf + out->used, key, len);
+  out->used += len;
+  out->buf[out->used++] = ' ';
+  if (value < 0) {
+    out->buf[out->used++] = '-';
+  }
+  do {
+    digits[ndigits++] = (char) ('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  while (ndigits > 0) {
+    out->buf[out->used++] = digits[--ndigits];
+  }
+  out->buf[out->used++] = '\n';
+}
+
+
+/* out_close: flush and release a writer.
+ * arguments: out: the writer
+ */
+void out_close(out_buffer *out)
+{
+  out_flush(out);
+  fflush(out->fp);
+  free(out->buf);
+  out->buf = NULL;
+}
+
+
+/*** Ordering. ***/
+
+/* compare_keys: qsort comparison of entries by key (byte order) */
+static int compare_keys(const void *a, const void *b)
+{
+  const table_entry *x = (const table_entry *) a;
+  const table_entry *y = (const table_entry *) b;
+  int c = memcmp(x->key, y->key, x->len < y->len ? x->len : y->len);
+
+  if (c != 0) {
+    return c;
+  }
+  return (x->len > y->len) - (x->len < y->len);
+}
+
+
+/* compare_counts: qsort comparison of entries by descending value,
+ * breaking ties by key */
+static int compare_counts(const void *a, const void *b)
+{
+  const table_entry *x = (const table_entry *) a;
+  const table_entry *y = (const table_entry *) b;
+
+  if (x->value != y->value) {
+    return x->value > y->value ? -1 : 1;
+  }
+  return compare_keys(a, b);
+}
+
+
+/*** Extraction. ***/
+
+/* collect: for_each_node callback appending a node to an entry array */
+static void collect(node *n, void *arg)
+{
+  table_entry **next = (table_entry **) arg;
+  (*next)->key = n->key;
+  (*next)->len = n->len;
+  (*next)->value = n->value;
+  (*next)++;
+}
+
+
+/* extract_entries: copy every key/value pair out of a table.
+ * arguments: ht: the table
+ *            n: where to store the number of entries
+ * return: new array of entries (keys still belong to the table)
+ */
+table_entry *extract_entries(hash_table *ht, size_t *n)
+{
+  table_entry *entries, *next;
+
+  /* one extra so an empty table doesn't ask for zero bytes */
+  entries = (table_entry *) malloc((ht->count + 1) * sizeof(table_entry));
+  if (entries == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  next = entries;
+  for_each_node(ht, collect, &next);
+  *n = ht->count;
+  return entries;
+}
+
+
+/*** Top K. ***/
+
+/*
+ * A bounded heap of the best 'k' entries seen so far.  The root is the
+ * worst of them, so a new entry only has to beat the root to get in.
+ */
+
+typedef struct
+{
+  table_entry *heap;
+  size_t size, k;
+} top_k;
+
+
+/* sift_down: restore the heap below position i.
+ * arguments: t: the heap
+ *            i: position whose entry may be out of place
+ */
+static void sift_down(top_k *t, size_t i)
+{
+  size_t child;
+  table_entry tmp;
+
+  for (; (child = 2 * i + 1) < t->size; i = child) {
+    /* the child that sorts later by count is the worse one */
+    if (child + 1 < t->size &&
+        compare_counts(&t->heap[child + 1], &t->heap[child]) > 0) {
+      child++;
+    }
+    if (compare_counts(&t->heap[child], &t->heap[i]) <= 0) {
+      break;
+    }
+    tmp = t->heap[i];
+    t->heap[i] = t->heap[child];
+    t->heap[child] = tmp;
+  }
+}
+
+
+/* offer: for_each_node callback offering a node to the heap */
+static void offer(node *n, void *arg)
+{
+  top_k *t = (top_k *) arg;
+  table_entry e;
+  size_t i, parent;
+
+  e.key = n->key;
+  e.len = n->len;
+  e.value = n->value;
+
+  if (t->size < t->k) { /* not full yet: sift up */
+    for (i = t->size++; i > 0; i = parent) {
+      parent = (i - 1) / 2;
+      if (compare_counts(&e, &t->heap[parent]) <= 0) {
+        break;
+      }
+      t->heap[i] = t->heap[parent];
+    }
+    t->heap[i] = e;
+  }
+  else if (compare_counts(&e, &t->heap[0]) < 0) { /* beats the worst */
+    t->heap[0] = e;
+    sift_down(t, 0);
+  }
+}
+
+
+/* print_top_k: print the entries with the highest values.
+ * arguments: ht: the table
+ *            k: number of entries to print
+ *            fp: stream to print to
+ */
+void print_top_k(hash_table *ht, size_t k, FILE *fp)
+{
+  top_k t;
+  out_buffer out;
+  size_t i;
+
+  if (k == 0) {
+    return;
+  }
+  t.k = k < ht->count ? k : ht->count;
+  t.size = 0;
+  t.heap = (table_entry *) malloc((t.k + 1) * sizeof(table_entry));
+  if (t.heap == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  if (t.k > 0) {
+    for_each_node(ht, offer, &t);
+  }
+
+  qsort(t.heap, t.size, sizeof(table_entry), compare_counts);
+  out_open(&out, fp);
+  for (i = 0; i < t.size; i++) {
+    out_pair(&out, t.heap[i].key, t.heap[i].len, t.heap[i].value);
+  }
+  out_close(&out);
+  free(t.heap);
+}
+
+
+/*** Parallel sort. ***/
+
+typedef struct
+{
+  table_entry *entries;
+  size_t n;
+  int (*compare)(const void *, const void *);
+  pthread_t thread;
+  int started;  /* 1 if 'thread' is sorting this run */
+} sort_job;
+
+
+/* sort_run: thread body sorting one run of entries */
+static void *sort_run(void *arg)
+{
+  sort_job *job = (sort_job *) arg;
+  qsort(job->entries, job->n, sizeof(table_entry), job->compare);
+  return NULL;
+}
+
+
+/* merge_runs: merge two adjacent sorted runs into 'out'.
+ * arguments: a, na: first run
+ *            b, nb: second run
+ *            out: destination with room for na + nb entries
+ *            compare: ordering of the runs
+ */
+static void merge_runs(const table_entry *a, size_t na,
+                       const table_entry *b, size_t nb, table_entry *out,
+                       int (*compare)(const void *, const void *))
+{
+  while (na > 0 && nb > 0) {
+    /* takes from 'a' on ties so the merge is stable */
+    if (compare(b, a) < 0) {
+      *out++ = *b++;
+      nb--;
+    }
+    else {
+      *out++ = *a++;
+      na--;
+    }
+  }
+  memcpy(out, a, na * sizeof(table_entry));
+  memcpy(out + na, b, nb * sizeof(table_entry));
+}
+
+
+/* parallel_sort: sort entries by cutting them into one run per thread,
+ *                sorting the runs concurrently, then merging them.
+ * arguments: entries, n: the entries
+ *            compare: ordering to sort into
+ *            nthreads: number of threads (runs) to use
+ */
+static void parallel_sort(table_entry *entries, size_t n,
+                          int (*compare)(const void *, const void *),
+                          int nthreads)
+{
+  sort_job *jobs;
+  table_entry *tmp, *src, *dst, *swap;
+  size_t *bounds, width, lo, mid, hi;
+  int i, nruns;
+
+  if (nthreads <= 1 || n < (size_t) nthreads * 1024) {
+    qsort(entries, n, sizeof(table_entry), compare);
+    return;
+  }
+
+  jobs = (sort_job *) calloc(nthreads, sizeof(sort_job));
+  bounds = (size_t *) malloc((nthreads + 1) * sizeof(size_t));
+  tmp = (table_entry *) malloc(n * sizeof(table_entry));
+  if (jobs == NULL || bounds == NULL || tmp == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+
+  for (i = 0; i <= nthreads; i++) {
+    bounds[i] = n / nthreads * i;
+  }
+  bounds[nthreads] = n;
+  for (i = 0; i < nthreads; i++) {
+    jobs[i].entries = entries + bounds[i];
+    jobs[i].n = bounds[i + 1] - bounds[i];
+    jobs[i].compare = compare;
+    if (i > 0) {
+      jobs[i].started =
+        pthread_create(&jobs[i].thread, NULL, sort_run, &jobs[i]) == 0;
+    }
+  }
+  sort_run(&jobs[0]);
+  for (i = 1; i < nthreads; i++) {
+    if (jobs[i].started) {
+      pthread_join(jobs[i].thread, NULL);
+    }
+    else {
+      sort_run(&jobs[i]);
+    }
+  }
+
+  /* merges neighbouring runs pairwise until one run is left */
+  src = entries;
+  dst = tmp;
+  for (nruns = nthreads, width = 1; nruns > 1;
+       nruns = (nruns + 1) / 2, width *= 2) {
+    for (i = 0; i < nthreads; i += 2 * (int) width) {
+      lo = bounds[i];
+      mid = bounds[i + (int) width < nthreads ? i + (int) width : nthreads];
+      hi = bounds[i + 2 * (int) width < nthreads ? i + 2 * (int) width
+                                                  : nthreads];
+      merge_runs(src + lo, mid - lo, src + mid, hi - mid, dst + lo, compare);
+    }
+    swap = src;
+    src = dst;
+    dst = swap;
+  }
+  if (src != entries) {
+    memcpy(entries, src, n * sizeof(table_entry));
+  }
+
+  free(tmp);
+  free(bounds);
+  free(jobs);
+}
+
+
+/* sort_entries: sort an entry array in place.
+ * arguments: entries, n: the entries
+ *            order: SORT_BY_KEY or SORT_BY_COUNT
+ *            nthreads: number of threads to sort with
+ */
+void sort_entries(table_entry *entries, size_t n, sort_order order,
+                  int nthreads)
+{
+  parallel_sort(entries, n,
+                order == SORT_BY_KEY ? compare_keys : compare_counts,
+                nthreads);
+}
+
+
+/* print_entries: print an entry array as 'key value' lines.
+ * arguments: entries, n: the entries
+ *            fp: stream to print to
+ */
+void print_entries(const table_entry *entries, size_t n, FILE *fp)
+{
+  out_buffer out;
+  size_t i;
+
+  out_open(&out, fp);
+  for (i = 0; i < n; i++) {
+    out_pair(&out, entries[i].key, entries[i].len, entries[i].value);
+  }
+  out_close(&out);
+}
+
+
+/* print_sorted: print every entry of a table in sorted order.
+ * arguments: ht: the table
+ *            order: SORT_BY_KEY or SORT_BY_COUNT
+ *            nthreads: number of threads to sort with
+ *            fp: stream to print to
+ */
+void print_sorted(hash_table *ht, sort_order order, int nthreads, FILE *fp)
+{
+  table_entry *entries;
+  size_t n;
+
+  entries = extract_entries(ht, &n);
+  sort_entries(entries, n, order, nthreads);
+  print_entries(entries, n, fp);
+  free(entries);
+}
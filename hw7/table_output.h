@@ -0,0 +1,84 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_output.h
+ *
+ *       Writing out hash table contents: a buffered writer for key/value
+ *       lines, top-K by count, and full sorts by key or by count.
+ *
+ */
+
+#ifndef TABLE_OUTPUT_H
+#define TABLE_OUTPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "hash_table.h"
+
+/* Size of the output buffer. */
+#define OUT_BUFFER_SIZE (1 << 20)
+
+/*
+ * Buffered writer.  Lines are formatted straight into a large buffer
+ * which is written out with fwrite() when it fills up.
+ */
+
+typedef struct
+{
+    FILE  *fp;
+    char  *buf;
+    size_t used;
+} out_buffer;
+
+/*
+ * One key/value pair copied out of a table for sorting.  'key' points
+ * at the table's own copy of the key.
+ */
+
+typedef struct
+{
+    const char *key;
+    size_t      len;
+    int         value;
+} table_entry;
+
+typedef enum
+{
+    SORT_BY_KEY,    /* ascending byte order of the keys */
+    SORT_BY_COUNT   /* descending value, ties in key order */
+} sort_order;
+
+
+/* Start buffering output for 'fp'. */
+void out_open(out_buffer *out, FILE *fp);
+
+/* Write one "key value" line. */
+void out_pair(out_buffer *out, const char *key, size_t len, int value);
+
+/* Write out whatever is buffered and release the buffer. */
+void out_close(out_buffer *out);
+
+/*
+ * Return a new array of every key/value pair in the table and store its
+ * length in '*n'.  The caller frees the array; the keys stay owned by
+ * the table.
+ */
+table_entry *extract_entries(hash_table *ht, size_t *n);
+
+/*
+ * Print the 'k' keys with the highest values, highest first, keeping
+ * only 'k' entries in memory.
+ */
+void print_top_k(hash_table *ht, size_t k, FILE *fp);
+
+/* Sort 'n' entries into the given order with 'nthreads' threads. */
+void sort_entries(table_entry *entries, size_t n, sort_order order,
+                  int nthreads);
+
+/* Print 'n' entries as "key value" lines, in array order. */
+void print_entries(const table_entry *entries, size_t n, FILE *fp);
+
+/* Print every key/value pair in the given order, sorting with 'nthreads'. */
+void print_sorted(hash_table *ht, sort_order order, int nthreads, FILE *fp);
+
+#endif  /* TABLE_OUTPUT_H */
@@ -0,0 +1,133 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_stats.c
+ *
+ *       Gathering and printing hash table statistics.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "table_stats.h"
+#include "bloom_filter.h"
+#include "memcheck.h"
+
+
+/* add_chains: add the chains of one slot array to the statistics.
+ * arguments: st: statistics being gathered
+ *            slot: the slot array
+ *            first, end: range of slots to look at
+ *            probes: running total of nodes visited to find every key
+ */
+static void add_chains(table_stats *st, node **slot, size_t first,
+                       size_t end, double *probes)
+{
+  size_t i, len;
+  node *n;
+
+  for (i = first; i < end; i++) {
+    len = 0;
+    for (n = slot[i]; n != NULL; n = n->next) {
+      st->key_bytes += n->len + 1;
+      len++;
+    }
+    st->chain_hist[len < STATS_MAX_CHAIN ? len : STATS_MAX_CHAIN]++;
+    if (len > st->max_chain) {
+      st->max_chain = len;
+    }
+    /* the k-th node of a chain is found after visiting k nodes */
+    *probes += len * (len + 1) / 2.0;
+  }
+}
+
+
+/* get_table_stats: gather statistics about a table.
+ * arguments: ht: the table
+ *            st: where to store the statistics
+ */
+void get_table_stats(hash_table *ht, table_stats *st)
+{
+  double probes = 0;
+
+  memset(st, 0, sizeof(table_stats));
+  st->count = ht->count;
+  st->counting = table_counters_enabled();
+  st->counters = ht->counters;
+  if (ht->image != NULL) {
+    st->node_bytes = ht->image_size;
+    return;
+  }
+
+  st->nslots = ht->nslots;
+  add_chains(st, ht->slot, 0, ht->nslots, &probes);
+  if (ht->old_slot != NULL) { /* chains a resize hasn't moved yet */
+    st->nslots += ht->old_nslots - ht->migrated;
+    add_chains(st, ht->old_slot, ht->migrated, ht->old_nslots, &probes);
+  }
+  st->load_factor = (double) st->count / st->nslots;
+  st->mean_probe = st->count > 0 ? probes / st->count : 0;
+  st->node_bytes = st->count * sizeof(node);
+  st->slot_bytes = ht->nslots * sizeof(node *);
+  if (ht->old_slot != NULL) {
+    st->slot_bytes += ht->old_nslots * sizeof(node *);
+  }
+  if (ht->bloom != NULL) {
+    st->filter_bytes = sizeof(bloom_filter) +
+                       ht->bloom->nblocks * BLOOM_BLOCK_BITS / 8;
+  }
+}
+
+
+/* table_bytes: memory a table uses, from its statistics.
+ * arguments: ht: the table
+ * return: bytes of the table structure, slots, nodes, keys and filter
+ */
+size_t table_bytes(hash_table *ht)
+{
+  table_stats st;
+
+  get_table_stats(ht, &st);
+  return sizeof(hash_table) + st.key_bytes + st.node_bytes +
+         st.slot_bytes + st.filter_bytes;
+}
+
+
+/* print_table_stats: print a table's statistics.
+ * arguments: ht: the table
+ *            fp: stream to print to
+ */
+void print_table_stats(hash_table *ht, FILE *fp)
+{
+  table_stats st;
+  int i;
+
+  get_table_stats(ht, &st);
+  fprintf(fp, "hash table statistics:\n");
+  fprintf(fp, "  keys           %lu\n", (unsigned long) st.count);
+  fprintf(fp, "  slots          %lu (load factor %.2f)\n",
+          (unsigned long) st.nslots, st.load_factor);
+  fprintf(fp, "  chain lengths ");
+  for (i = 0; i <= STATS_MAX_CHAIN; i++) {
+    fprintf(fp, " %d%s:%lu", i, i == STATS_MAX_CHAIN ? "+" : "",
+            (unsigned long) st.chain_hist[i]);
+  }
+  fprintf(fp, "\n");
+  fprintf(fp, "  longest chain  %lu\n", (unsigned long) st.max_chain);
+  fprintf(fp, "  mean probe     %.2f nodes per key found\n", st.mean_probe);
+  fprintf(fp, "  memory         %lu key, %lu node, %lu slot, %lu filter "
+          "bytes\n", (unsigned long) st.key_bytes,
+          (unsigned long) st.node_bytes, (unsigned long) st.slot_bytes,
+          (unsigned long) st.filter_bytes);
+  if (st.counting) {
+    fprintf(fp, "  searches       %lu hits, %lu misses\n",
+            st.counters.hits, st.counters.misses);
+    fprintf(fp, "  resizes        %lu (%.3f ms)\n", st.counters.resizes,
+            st.counters.resize_seconds * 1e3);
+  }
+  else {
+    fprintf(fp, "  searches and resizes not counted (built without "
+            "HT_STATS)\n");
+  }
+}
@@ -0,0 +1,56 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_stats.h
+ *
+ *       Health statistics for a hash table: how full it is, how long its
+ *       chains are, what its memory goes to, and (when hash_table.c is
+ *       built with HT_STATS) how its searches and resizes went.
+ *
+ */
+
+#ifndef TABLE_STATS_H
+#define TABLE_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "hash_table.h"
+
+/* Chains this long or longer share the last histogram bucket. */
+#define STATS_MAX_CHAIN 8
+
+typedef struct
+{
+    size_t count;        /* number of keys */
+    size_t nslots;       /* slots, counting an unfinished resize's old ones */
+    double load_factor;  /* keys per slot */
+    size_t chain_hist[STATS_MAX_CHAIN + 1];  /* slots by chain length */
+    size_t max_chain;    /* longest chain */
+    double mean_probe;   /* nodes visited, on average, to find a key */
+    size_t key_bytes;    /* key characters and their zero bytes */
+    size_t node_bytes;
+    size_t slot_bytes;
+    size_t filter_bytes; /* the Bloom filter, if any */
+    int counting;        /* 1 if 'counters' are kept */
+    table_counters counters;
+} table_stats;
+
+
+/*
+ * Fill in 'st' for the table.  This walks every chain, so it takes time
+ * proportional to the size of the table.  A table loaded from a file
+ * reports its keys, its counters and the size of the file (as node
+ * bytes) only.
+ */
+void get_table_stats(hash_table *ht, table_stats *st);
+
+/*
+ * Return the memory the table uses (not counting malloc's overhead),
+ * from get_table_stats().
+ */
+size_t table_bytes(hash_table *ht);
+
+/* Print the table's statistics in a readable form. */
+void print_table_stats(hash_table *ht, FILE *fp);
+
+#endif  /* TABLE_STATS_H */
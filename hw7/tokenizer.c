@@ -0,0 +1,555 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: tokenizer.c
+ *
+ *       Zero-copy input and whitespace tokenizer for the word counter.
+ *       Regular files are mmap'd; everything else is read in large
+ *       blocks.  Tokens are handed out as (pointer, length) slices of
+ *       the input so nothing is copied here.
+ *
+ *       The folding tokenizer keeps that property by rewriting words in
+ *       place: every case mapping it applies keeps the character's
+ *       encoded length, so a folded word occupies exactly the bytes it
+ *       was read from.  Files are mapped copy-on-write, so only pages
+ *       that actually contain upper-case letters get copied.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "tokenizer.h"
+#include "memcheck.h"
+
+/* Size of the first buffer used when the input can't be mapped. */
+#define READ_BLOCK (1 << 20)
+
+
+/*** Input. ***/
+
+/* read_all: read everything from 'fd' into a heap buffer.
+ * arguments: fd: file descriptor to read until end of file
+ *            in: input buffer to fill in
+ * return: 0 on success, -1 on a read error
+ */
+static int read_all(int fd, input_buffer *in)
+{
+  char *buf, *bigger;
+  size_t cap = READ_BLOCK, size = 0;
+  ssize_t n;
+
+  buf = (char *) malloc(cap);
+  if (buf == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+
+  while ((n = read(fd, buf + size, cap - size)) != 0) {
+    if (n < 0) {
+      free(buf);
+      return -1;
+    }
+    size += (size_t) n;
+    /* doubles the buffer when it fills up */
+    if (size == cap) {
+      bigger = (char *) realloc(buf, 2 * cap);
+      if (bigger == NULL) {
+        fprintf(stderr, "Error allocating memory.\n");
+        exit(1);
+      }
+      buf = bigger;
+      cap *= 2;
+    }
+  }
+
+  in->data = buf;
+  in->size = size;
+  in->mapped = 0;
+  return 0;
+}
+
+
+/* open_input: make the contents of a file available in memory.
+ * arguments: filename: file to open, or "-" for standard input
+ *            in: input buffer to fill in
+ * return: 0 on success, -1 on failure
+ */
+int open_input(const char *filename, input_buffer *in)
+{
+  int fd, result;
+  struct stat st;
+  void *addr;
+
+  if (strcmp(filename, "-") == 0) {
+    fd = STDIN_FILENO;
+  }
+  else if ((fd = open(filename, O_RDONLY)) < 0) {
+    return -1;
+  }
+
+  /* maps regular files; anything else falls through to plain reads */
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    if (st.st_size == 0) {
+      in->data = NULL;
+      in->size = 0;
+      in->mapped = 1;
+      if (fd != STDIN_FILENO) {
+        close(fd);
+      }
+      return 0;
+    }
+    addr = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      posix_madvise(addr, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+      in->data = (char *) addr;
+      in->size = (size_t) st.st_size;
+      in->mapped = 1;
+      if (fd != STDIN_FILENO) {
+        close(fd);
+      }
+      return 0;
+    }
+  }
+
+  result = read_all(fd, in);
+  if (fd != STDIN_FILENO) {
+    close(fd);
+  }
+  return result;
+}
+
+
+/* close_input: release the memory behind an input buffer.
+ * arguments: in: input buffer filled in by open_input()
+ */
+void close_input(input_buffer *in)
+{
+  if (in->data == NULL) {
+    return;
+  }
+  if (in->mapped) {
+    munmap(in->data, in->size);
+  }
+  else {
+    free(in->data);
+  }
+  in->data = NULL;
+  in->size = 0;
+}
+
+
+/*** Tokenizing. ***/
+
+/* is_space: same set of characters as isspace() in the "C" locale */
+#define is_space(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+
+#ifdef __SSE2__
+
+/* space_mask: classify 16 bytes at once.
+ * arguments: p: pointer to at least 16 readable bytes
+ * return: bit i is set if p[i] is whitespace
+ */
+static unsigned space_mask(const char *p)
+{
+  __m128i c = _mm_loadu_si128((const __m128i *) p);
+  __m128i sp = _mm_cmpeq_epi8(c, _mm_set1_epi8(' '));
+  /* '\t' .. '\r' is 9 .. 13; bytes >= 0x80 compare as negative */
+  __m128i ctl = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)),
+                              _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1)));
+  return (unsigned) _mm_movemask_epi8(_mm_or_si128(sp, ctl));
+}
+
+#endif  /* __SSE2__ */
+
+
+/* skip_space: find the first non-whitespace byte.
+ * arguments: p, end: range of bytes to scan
+ * return: pointer to the first non-whitespace byte, or 'end'
+ */
+static const char *skip_space(const char *p, const char *end)
+{
+#ifdef __SSE2__
+  unsigned m;
+  for (; end - p >= 16; p += 16) {
+    m = ~space_mask(p) & 0xFFFF;
+    if (m != 0) {
+      return p + __builtin_ctz(m);
+    }
+  }
+#endif
+  while (p < end && is_space(*p)) {
+    p++;
+  }
+  return p;
+}
+
+
+/* skip_word: find the first whitespace byte.
+ * arguments: p, end: range of bytes to scan
+ * return: pointer to the first whitespace byte, or 'end'
+ */
+static const char *skip_word(const char *p, const char *end)
+{
+#ifdef __SSE2__
+  unsigned m;
+  for (; end - p >= 16; p += 16) {
+    m = space_mask(p);
+    if (m != 0) {
+      return p + __builtin_ctz(m);
+    }
+  }
+#endif
+  while (p < end && !is_space(*p)) {
+    p++;
+  }
+  return p;
+}
+
+
+/* tokenize: split a buffer into whitespace-separated tokens.
+ * arguments: data: first byte to scan
+ *            size: number of bytes to scan
+ *            fn: called with each token's start and length
+ *            arg: passed through to 'fn'
+ * return: number of tokens found
+ */
+size_t tokenize(const char *data, size_t size, token_fn fn, void *arg)
+{
+  const char *p = data, *end = data + size, *word;
+  size_t ntokens = 0;
+
+  if (data == NULL) {
+    return 0;
+  }
+
+  for (;;) {
+    word = skip_space(p, end);
+    if (word == end) {
+      break;
+    }
+    p = skip_word(word, end);
+    fn(word, (size_t) (p - word), arg);
+    ntokens++;
+  }
+  return ntokens;
+}
+
+
+/*** Folding tokenizer. ***/
+
+/* is_alnum: ASCII letter or digit */
+#define is_alnum(c) \
+  (((c) >= '0' && (c) <= '9') || (((c) | 0x20) >= 'a' && ((c) | 0x20) <= 'z'))
+
+/*
+ * UTF-8 lead bytes: the length of the sequence each byte starts, or 0
+ * for bytes that can't start one (continuation bytes, C0, C1 and F5 to
+ * FF, which could only start overlong or out-of-range sequences).
+ */
+static const unsigned char utf8_length[256] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  /* 00 */
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 80 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  /* C0 */
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,  /* E0 */
+  4, 4, 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0   /* F0 */
+};
+
+/*
+ * Allowed range of the second byte after the lead bytes where it isn't
+ * the usual 80 to BF: these rule out overlong forms (E0, F0), UTF-16
+ * surrogates (ED) and code points above 10FFFF (F4).
+ */
+#define second_min(lead) ((lead) == 0xE0 ? 0xA0 : (lead) == 0xF0 ? 0x90 : 0x80)
+#define second_max(lead) ((lead) == 0xED ? 0x9F : (lead) == 0xF4 ? 0x8F : 0xBF)
+
+
+/* decode_utf8: decode one UTF-8 character.
+ * arguments: p, end: bytes to decode from; p[0] is at least 0x80
+ *            cp: where to store the code point
+ * return: length of the character in bytes, or 0 if the bytes at 'p'
+ *         aren't valid UTF-8
+ */
+static int decode_utf8(const unsigned char *p, const unsigned char *end,
+                       unsigned long *cp)
+{
+  int len = utf8_length[p[0]], i;
+
+  if (len < 2 || end - p < len ||
+      p[1] < second_min(p[0]) || p[1] > second_max(p[0])) {
+    return 0;
+  }
+  *cp = p[0] & (0x7F >> len);
+  for (i = 1; i < len; i++) {
+    if ((p[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+    *cp = (*cp << 6) | (p[i] & 0x3F);
+  }
+  return len;
+}
+
+
+/* is_word_char: whether a non-ASCII code point belongs in words.
+ *               Without the Unicode tables this is an approximation:
+ *               everything counts except the Latin-1 symbols and
+ *               punctuation, the general punctuation block (dashes,
+ *               curly quotes, odd spaces) and CJK punctuation.
+ * arguments: cp: code point, at least 0x80
+ * return: 1 if the code point is part of a word, 0 if it separates words
+ */
+static int is_word_char(unsigned long cp)
+{
+  if (cp < 0xC0) {
+    return cp == 0xAA || cp == 0xB5 || cp == 0xBA;  /* the letters */
+  }
+  return cp != 0xD7 && cp != 0xF7 && cp != 0xFEFF &&
+         !(cp >= 0x2000 && cp <= 0x206F) && !(cp >= 0x3000 && cp <= 0x303F);
+}
+
+
+/* fold_case: lower-case a code point whose lower case has the same
+ *            UTF-8 length: Latin-1, Latin Extended-A, Greek and
+ *            Cyrillic capitals.  Anything else is left alone.
+ * arguments: cp: code point, at least 0x80
+ * return: the folded code point
+ */
+static unsigned long fold_case(unsigned long cp)
+{
+  if (cp > 0x42F) {  /* past the last capital handled */
+    return cp;
+  }
+  if ((cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) ||     /* Latin-1 */
+      (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) ||  /* Greek */
+      (cp >= 0x410 && cp <= 0x42F)) {                 /* Cyrillic */
+    return cp + 0x20;
+  }
+  if (cp >= 0x400 && cp <= 0x40F) {
+    return cp + 0x50;
+  }
+  /* Latin Extended-A pairs capitals with the code point after them */
+  if (((cp >= 0x100 && cp <= 0x137 && cp != 0x130) ||
+       (cp >= 0x14A && cp <= 0x177)) && cp % 2 == 0) {
+    return cp + 1;
+  }
+  if (((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) &&
+      cp % 2 == 1) {
+    return cp + 1;
+  }
+  return cp;
+}
+
+
+/* scan_utf8: look at a non-ASCII character, folding it in place.
+ * arguments: p, end: bytes to scan; p[0] is at least 0x80
+ *            in_word: where to store whether the character is part of a
+ *                     word
+ * return: length of the character (1 for an invalid byte, which
+ *         separates words)
+ */
+static int scan_utf8(char *p, const char *end, int *in_word)
+{
+  unsigned long cp, folded;
+  int len = decode_utf8((unsigned char *) p, (const unsigned char *) end,
+                        &cp);
+
+  if (len == 0) {
+    *in_word = 0;
+    return 1;
+  }
+  *in_word = is_word_char(cp);
+  folded = fold_case(cp);
+  if (folded != cp) { /* every fold stays in the two-byte range */
+    p[0] = (char) (0xC0 | (folded >> 6));
+    p[1] = (char) (0x80 | (folded & 0x3F));
+  }
+  return len;
+}
+
+
+#ifdef __SSE2__
+
+/* fold_block: fold the upper-case ASCII letters of 16 bytes.
+ * arguments: p: pointer to at least 16 bytes, all belonging to this
+ *               thread's part of the input
+ * return: bit i is set if p[i] is an ASCII letter or digit
+ */
+static unsigned fold_block(char *p)
+{
+  __m128i c = _mm_loadu_si128((const __m128i *) p);
+  __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)),
+                                _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+  __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+
+  /* only writes when there is something to fold, so untouched pages of
+   * a mapped file are never copied */
+  if (_mm_movemask_epi8(upper) != 0) {
+    _mm_storeu_si128((__m128i *) p,
+                     _mm_or_si128(c, _mm_and_si128(upper,
+                                                   _mm_set1_epi8(0x20))));
+  }
+  return (unsigned) _mm_movemask_epi8(_mm_or_si128(alpha, digit));
+}
+
+#endif  /* __SSE2__ */
+
+
+/* skip_separators: find the first byte that can start a word.
+ * arguments: p, end: range of bytes to scan
+ * return: pointer to the first ASCII letter or digit or non-ASCII byte,
+ *         or 'end'
+ */
+static char *skip_separators(char *p, const char *end)
+{
+#ifdef __SSE2__
+  unsigned m;
+  for (; end - p >= 16; p += 16) {
+    /* letters and digits, or bytes >= 0x80 */
+    m = fold_block(p) |
+        (unsigned) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) p));
+    if (m != 0) {
+      return p + __builtin_ctz(m);
+    }
+  }
+#endif
+  while (p < end && !is_alnum(*p) && !(*p & 0x80)) {
+    p++;
+  }
+  return p;
+}
+
+
+/* scan_ascii_word: fold and skip the ASCII letters and digits of a word.
+ * arguments: p, end: range of bytes to scan
+ * return: pointer to the first byte that isn't an ASCII letter or digit
+ */
+static char *scan_ascii_word(char *p, const char *end)
+{
+#ifdef __SSE2__
+  unsigned m;
+  /* short runs between non-ASCII letters aren't worth a block */
+  if (p < end && !is_alnum(*p)) {
+    return p;
+  }
+  for (; end - p >= 16; p += 16) {
+    m = ~fold_block(p) & 0xFFFF;
+    if (m != 0) {
+      return p + __builtin_ctz(m);
+    }
+  }
+#endif
+  for (; p < end && is_alnum(*p); p++) {
+    if (*p >= 'A' && *p <= 'Z') {
+      *p += 'a' - 'A';
+    }
+  }
+  return p;
+}
+
+
+/* tokenize_folded: split a buffer into case-folded words.
+ * arguments: data: first byte to scan (rewritten in place)
+ *            size: number of bytes to scan
+ *            fn: called with each word's start and length
+ *            arg: passed through to 'fn'
+ * return: number of words found
+ */
+size_t tokenize_folded(char *data, size_t size, token_fn fn, void *arg)
+{
+  char *p = data, *end = data + size, *word;
+  size_t nwords = 0;
+  int in_word, len;
+
+  if (data == NULL) {
+    return 0;
+  }
+
+  for (;;) {
+    /* find the start of a word; a non-ASCII byte may not be one */
+    p = skip_separators(p, end);
+    if (p == end) {
+      break;
+    }
+    if (*p & 0x80) {
+      len = scan_utf8(p, end, &in_word);
+      if (!in_word) {
+        p += len;
+        continue;
+      }
+    }
+
+    /* runs of ASCII go at 16 bytes a time, other characters one by one */
+    word = p;
+    for (;;) {
+      p = scan_ascii_word(p, end);
+      if (p == end || !(*p & 0x80)) {
+        break;
+      }
+      len = scan_utf8(p, end, &in_word);
+      if (!in_word) {
+        break;
+      }
+      p += len;
+    }
+    fn(word, (size_t) (p - word), arg);
+    nwords++;
+  }
+  return nwords;
+}
+
+
+/* tokenize_words: split a buffer into words in either mode.
+ * arguments: data, size: the bytes to scan
+ *            mode: WORDS_PLAIN or WORDS_FOLDED
+ *            fn, arg: as for tokenize()
+ * return: number of words found
+ */
+size_t tokenize_words(char *data, size_t size, word_mode mode, token_fn fn,
+                      void *arg)
+{
+  if (mode == WORDS_FOLDED) {
+    return tokenize_folded(data, size, fn, arg);
+  }
+  return tokenize(data, size, fn, arg);
+}
+
+
+/* token_boundary: find a place to split the input between tokens.
+ * arguments: data, size: the whole input
+ *            pos: offset to start looking from
+ * return: offset of the first whitespace byte at or after 'pos', or 'size'
+ */
+size_t token_boundary(const char *data, size_t size, size_t pos)
+{
+  if (pos >= size) {
+    return size;
+  }
+  return (size_t) (skip_word(data + pos, data + size) - data);
+}
@@ -0,0 +1,85 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: tokenizer.h
+ *
+ *       Zero-copy input and tokenizers for the word counter: one that
+ *       splits at whitespace, and one that splits at punctuation too
+ *       and folds words to lower case.
+ *
+ */
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stddef.h>
+
+/*
+ * The whole input, either mapped straight from the file or (for pipes
+ * and other inputs that can't be mapped) read into one heap buffer.
+ */
+
+typedef struct
+{
+    char   *data;   /* first byte of input (NULL if the input is empty) */
+    size_t  size;   /* number of bytes of input */
+    int     mapped; /* 1 if 'data' is an mmap'd region, 0 if heap memory */
+} input_buffer;
+
+/*
+ * How the input is split into words.
+ */
+
+typedef enum
+{
+    WORDS_PLAIN,   /* whitespace-separated tokens, taken byte for byte */
+    WORDS_FOLDED   /* runs of letters and digits, folded to lower case */
+} word_mode;
+
+/*
+ * Called once per token with a pointer into the input buffer and the
+ * token's length.  The token is NOT null-terminated.
+ */
+
+typedef void (*token_fn)(const char *word, size_t len, void *arg);
+
+
+/*
+ * Open 'filename' ("-" means standard input) and make its contents
+ * available in 'in'.  The buffer is writable: a mapped file is private
+ * to the process, so rewriting it never changes the file.  Return 0 on
+ * success, -1 on failure.
+ */
+int open_input(const char *filename, input_buffer *in);
+
+/* Release the memory behind an input buffer. */
+void close_input(input_buffer *in);
+
+/*
+ * Split 'size' bytes at 'data' into whitespace-separated tokens and call
+ * 'fn' on each one.  Return the number of tokens found.
+ */
+size_t tokenize(const char *data, size_t size, token_fn fn, void *arg);
+
+/*
+ * Split 'size' bytes at 'data' into words and call 'fn' on each one.
+ * A word is a run of ASCII letters and digits and non-ASCII letters in
+ * UTF-8; whitespace, punctuation, symbols and invalid UTF-8 separate
+ * words.  Upper-case letters (ASCII, Latin-1, Latin Extended-A, Greek
+ * and Cyrillic) are lowered in place, so the buffer must be writable.
+ * Return the number of words found.
+ */
+size_t tokenize_folded(char *data, size_t size, token_fn fn, void *arg);
+
+/* Call tokenize() or tokenize_folded() as 'mode' says. */
+size_t tokenize_words(char *data, size_t size, word_mode mode, token_fn fn,
+                      void *arg);
+
+/*
+ * Return the offset of the first whitespace byte at or after 'pos' (or
+ * 'size' if there is none).  Splitting the input at such offsets never
+ * cuts a token in two, in either mode.
+ */
+size_t token_boundary(const char *data, size_t size, size_t pos);
+
+#endif  /* TOKENIZER_H */
@@ -0,0 +1,82 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: word_map.c
+ *
+ *       The word_map instantiation of the generic hash map, and the word
+ *       counter using it.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "word_map.h"
+#include "tokenizer.h"
+#include "memcheck.h"
+
+HASH_MAP_FUNCTIONS(word_map, word_key, int, word_key_hash, word_key_equal)
+
+
+/* count_token: token callback counting one word in a word_map */
+static void count_token(const char *word, size_t len, void *arg)
+{
+  word_key key;
+  int inserted;
+
+  key.s = word;
+  key.len = len;
+  key.hash = hash64(word, len);
+  (*word_map_put((word_map *) arg, &key, &inserted))++;
+}
+
+
+/* count_words_map: count the words of an input buffer.
+ * arguments: data: first byte of the input
+ *            size: number of bytes of input
+ *            mode: how to split the input into words
+ * return: new map from each word (pointing into 'data') to its count
+ */
+word_map *count_words_map(char *data, size_t size, word_mode mode)
+{
+  word_map *wm = word_map_create();
+  tokenize_words(data, size, mode, count_token, wm);
+  return wm;
+}
+
+
+/* free_word_map: free a map (but not the input its words point into).
+ * arguments: wm: pointer to the map to be freed
+ */
+void free_word_map(word_map *wm)
+{
+  word_map_free(wm);
+}
+
+
+/* word_map_entries: copy every word and count out of a map.
+ * arguments: wm: the map
+ *            n: where to store the number of entries
+ * return: new array of entries (keys still point into the input)
+ */
+table_entry *word_map_entries(const word_map *wm, size_t *n)
+{
+  table_entry *entries;
+  word_map_entry *e;
+  size_t pos = 0, i = 0;
+
+  /* one extra so an empty map doesn't ask for zero bytes */
+  entries = (table_entry *) malloc((wm->count + 1) * sizeof(table_entry));
+  if (entries == NULL) {
+    fprintf(stderr, "Error allocating memory.\n");
+    exit(1);
+  }
+  while ((e = word_map_next(wm, &pos)) != NULL) {
+    entries[i].key = e->key.s;
+    entries[i].len = e->key.len;
+    entries[i].value = e->value;
+    i++;
+  }
+  *n = i;
+  return entries;
+}
@@ -0,0 +1,60 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: word_map.h
+ *
+ *       The word counter on top of the generic hash map (hash_map.h):
+ *       a map from words in the input buffer to their counts.
+ *
+ */
+
+#ifndef WORD_MAP_H
+#define WORD_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_map.h"
+#include "table_output.h"
+#include "tokenizer.h"
+
+/*
+ * A word is kept as a pointer into the input and a length, so counting
+ * never copies a key; the input must stay open while the map is used.
+ * The hash is kept with it so growing and comparing never rehash.
+ */
+
+typedef struct
+{
+    const char *s;
+    size_t      len;
+    uint64_t    hash;
+} word_key;
+
+/*
+ * The hash is mixed so its low bits can pick the slot.  Hashes and
+ * lengths reject almost every other word before the characters are
+ * compared.
+ */
+#define word_key_hash(k) mix64((k)->hash)
+#define word_key_equal(a, b) \
+  ((a)->hash == (b)->hash && (a)->len == (b)->len && \
+   memcmp((a)->s, (b)->s, (a)->len) == 0)
+
+HASH_MAP_TYPES(word_map, word_key, int)
+
+
+/*
+ * Count the words in 'size' bytes at 'data', split as 'mode' says, and
+ * return a new map from each word to its count.
+ */
+word_map *count_words_map(char *data, size_t size, word_mode mode);
+
+void free_word_map(word_map *wm);
+
+/*
+ * Return a new array of every word and count in the map and store its
+ * length in '*n'.  The caller frees the array.
+ */
+table_entry *word_map_entries(const word_map *wm, size_t *n);
+
+#endif  /* WORD_MAP_H */
@@ -0,0 +1,2086 @@
+/*
+ * FILE: memcheck.c
+ *
+ *       Simple-minded memory leak checker for C programs.  Built once,
+ *       into libmemcheck.a, for all the assignments (see Makefile).
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef MEMCHECK_THREADS
+#include <pthread.h>
+#endif
+
+#define MEMCHECK_C
+#include "memcheck.h"
+#include "slab.h"
+
+#define DEBUG 0
+
+#ifdef MEMCHECK_THREADS
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
+/*
+ * Totals for one call site: every allocation made from one line of one
+ * file.
+ */
+
+typedef
+struct _mem_site
+{
+    char   *filename;       /* Name of file where allocation occurred.     */
+    int     lineno;         /* Line number of the allocation.              */
+    size_t  live_bytes;     /* Bytes allocated here and not yet freed.     */
+    size_t  live_count;     /* Blocks allocated here and not yet freed.    */
+    size_t  peak_bytes;     /* Largest value 'live_bytes' has had.         */
+    size_t  total_bytes;    /* Bytes ever allocated here.                  */
+    unsigned long nallocs;  /* Number of allocations ever made here.       */
+    int     shard;          /* Pool shard the record belongs to.           */
+    unsigned int id;        /* Number of the site in the event log.        */
+}
+mem_site;
+
+
+/*
+ * Definition of data structure to keep memory allocation information.
+ * Each node is a header placed just before the block it describes, in
+ * the same underlying allocation, so tracking a block costs no extra
+ * calls to malloc.
+ */
+
+typedef
+struct _mem_node
+{
+    size_t  nbytes;      /* Number of bytes allocated.                     */
+    unsigned long weight;   /* Allocations the node stands for, in       */
+                            /* 1/WEIGHT_ONE units (see sampling below).  */
+    mem_site *site;      /* Where the allocation occurred.                 */
+    struct _mem_node *prev;     /* Neighbours in the memory pool list. */
+    struct _mem_node *next;
+    unsigned int offset; /* Bytes from the start of the underlying         */
+                         /* allocation to the node (for aligned blocks).   */
+    unsigned int magic;  /* NODE_MAGIC while the block is live; last, so   */
+                         /* that it guards the front of the block.         */
+}
+mem_node;
+
+/* Marks a header as belonging to a live block. */
+#define NODE_MAGIC 0x6D656D63U
+
+/* Marks the header of a live block that sampling left untracked: only
+ * 'magic', 'offset' and 'nbytes' are filled in. */
+#define UNTRACKED_MAGIC 0x6D656D73U
+
+/* Weight of a node that stands for itself only. */
+#define WEIGHT_ONE 65536UL
+
+/* 'x' bytes or blocks counted 'w' times, rounded. */
+#define WEIGHTED(x, w) \
+    ((size_t)(((x) * (w) + WEIGHT_ONE / 2) / WEIGHT_ONE))
+
+/*
+ * Size of the header in front of each block, rounded up so that the
+ * block is as aligned as malloc's own blocks.
+ */
+#define HEADER_SIZE ((sizeof(mem_node) + 15) & ~(size_t)15)
+
+#define NODE_OF(addr)  ((mem_node *)((char *)(addr) - HEADER_SIZE))
+#define BLOCK_OF(n)    ((void *)((char *)(n) + HEADER_SIZE))
+#define MEM_OF(n)      ((void *)((char *)(n) - (n)->offset))
+
+
+/*
+ * Function prototypes.
+ */
+
+void       *allocate_mem_node(mem_node *n, char *filename, int lineno);
+void        free_mem_node(mem_node *n);
+void        free_mem_node_and_adjust_pool(mem_node *n);
+void        free_all_mem_nodes(void);
+mem_node   *find_node(void *addr);
+void       *checked_malloc_fn(size_t size, char *filename, int lineno);
+void       *checked_calloc_fn(size_t nmemb, size_t size,
+                              char *filename, int lineno);
+void        checked_free_fn(void *ptr, char *filename, int lineno);
+void       *checked_realloc_fn(void *ptr, size_t size,
+                               char *filename, int lineno);
+char       *checked_strdup_fn(const char *s, char *filename, int lineno);
+char       *checked_strndup_fn(const char *s, size_t n,
+                               char *filename, int lineno);
+void       *checked_aligned_alloc_fn(size_t alignment, size_t size,
+                                     char *filename, int lineno);
+void        print_memory_leaks(void);
+void        print_memory_profile(int max_sites);
+void        set_memory_sampling(size_t interval);
+void        dump_pool(void);
+
+
+/*
+ * The memory pool is split into shards, each with its own list of
+ * blocks, its own call site table and its own lock.  Each thread
+ * allocates from a home shard of its own (while there are no more
+ * threads than shards), so threads only meet on a lock when one frees a
+ * block another allocated.  Each site record belongs to one shard, and
+ * a block is always linked into its site's shard.
+ *
+ * The blocks of a shard are a circular doubly linked list through the
+ * headers, starting and ending at the dummy node 'pool', so a block is
+ * linked in and unlinked in constant time without searching.
+ *
+ * The call sites are in a hash table keyed by the filename pointer and
+ * line number (open addressing, linear probing).  Sites never move once
+ * created, so each header can point to its own.
+ */
+
+typedef
+struct _pool_shard
+{
+#ifdef MEMCHECK_THREADS
+    pthread_mutex_t lock;
+#endif
+    mem_node   pool;
+    mem_site **sites;       /* 'sites_size' slots, NULL when empty.       */
+    size_t     sites_size;  /* A power of two.                            */
+    size_t     sites_count;
+    size_t     live_bytes;  /* Bytes live in the shard, now and at most.  */
+    size_t     peak_bytes;
+    memcheck_event *log;    /* Events not yet written to the log.         */
+    size_t     log_count;
+}
+pool_shard;
+
+/* Shards are padded to a multiple of a cache line, so that threads
+ * working on neighbouring shards don't slow each other down. */
+typedef
+union _padded_shard
+{
+    pool_shard s;
+    char       pad[(sizeof(pool_shard) + 63) & ~(size_t)63];
+}
+padded_shard;
+
+/*
+ * When built with -DMEMCHECK_THREADS, there is a shard per thread (up
+ * to NSHARDS threads, after which threads share), and every access to a
+ * shard holds its lock.  Otherwise there is one shard and no locking.
+ */
+
+#ifdef MEMCHECK_THREADS
+#define NSHARDS 16
+static pthread_once_t shards_once = PTHREAD_ONCE_INIT;
+#define LOCK_SHARD(s)    pthread_mutex_lock(&(s)->lock)
+#define UNLOCK_SHARD(s)  pthread_mutex_unlock(&(s)->lock)
+#else
+#define NSHARDS 1
+#define LOCK_SHARD(s)
+#define UNLOCK_SHARD(s)
+#endif
+
+static THREAD_LOCAL int home_shard = -1;
+
+static padded_shard shards[NSHARDS];
+
+/* Number of threads that have been given a home shard. */
+static int nthreads_seen = 0;
+
+/* Number of call sites ever created (in any shard). */
+static unsigned int nsites_made = 0;
+
+/* Number of sites a shard's table starts with. */
+#define MIN_SITES 256
+
+/* Leaked blocks listed one by one before the rest are summarized. */
+#define MAX_LEAK_LINES 20
+
+
+/*
+ * Sampling.  With a sample interval of N bytes (set by MEMCHECK_SAMPLE
+ * in the environment or by set_memory_sampling()), allocations are
+ * tracked at random points on average N bytes apart, the gaps drawn
+ * from an exponential distribution, as if each allocated byte were
+ * picked with probability 1/N.  A block of 's' bytes is then tracked
+ * with probability p = 1 - exp(-s/N), and its node is weighted by 1/p,
+ * so that the totals of the tracked blocks estimate those of all of
+ * them.  Untracked blocks still get a header, to tell them from the
+ * others on free, but take no lock and touch no shared data.
+ *
+ * Each thread has its own countdown and random number generator.
+ */
+
+static size_t sample_interval = 0;  /* 0 tracks every allocation. */
+
+static THREAD_LOCAL size_t bytes_until_sample = 0;
+static THREAD_LOCAL unsigned long sample_random = 0;
+
+
+/*
+ * Guard modes, chosen by MEMCHECK_GUARD in the environment before the
+ * first allocation:
+ *
+ *   canary  CANARY_SIZE bytes of CANARY_BYTE follow each block, and are
+ *           checked when the block is freed or resized and at exit.  In
+ *           front of the block, the header's magic number serves the
+ *           same purpose: a write just before a block makes freeing it
+ *           an invalid free.
+ *   page    each block has pages of its own, mapped so that it ends
+ *           just before an inaccessible page, and an access past its
+ *           end faults on the spot.  Blocks stay 16-byte aligned, so the
+ *           few bytes left before the guard page are canary bytes,
+ *           checked as above.  Freed blocks are made read-only and
+ *           kept in a quarantine of the last QUARANTINE_BLOCKS freed,
+ *           so that a write to one faults and a second free of one is
+ *           reported; older ones are unmapped, and a second free of
+ *           those faults instead.  Each block takes two of the
+ *           process's memory mappings, which Linux limits to about
+ *           65,000 by default.
+ */
+
+typedef enum
+{
+    GUARD_NONE,
+    GUARD_CANARY,
+    GUARD_PAGE
+}
+guard_mode;
+
+static guard_mode guard = GUARD_NONE;
+
+#define CANARY_SIZE 8
+#define CANARY_BYTE 0xFD
+
+static size_t page_size = 0;
+static int    zero_fd   = -1;   /* /dev/zero, mapped for guarded blocks */
+
+#define ROUND_UP(x, m)  (((x) + (m) - 1) / (m) * (m))
+
+/* Freed guarded blocks kept mapped, oldest first from 'quarantine_next'. */
+#define QUARANTINE_BLOCKS 1024
+
+typedef
+struct _quarantined
+{
+    char  *map;
+    size_t len;
+}
+quarantined;
+
+static quarantined quarantine[QUARANTINE_BLOCKS];
+static size_t      quarantine_next = 0;
+
+#ifdef MEMCHECK_THREADS
+static pthread_mutex_t quarantine_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+/*
+ * The allocator under the blocks and their headers, chosen by
+ * MEMCHECK_BACKEND in the environment before the first allocation:
+ * "malloc" (the default) for the C library's, or "slab" for the
+ * size-class allocator of slab.c, which serves blocks of up to SLAB_MAX
+ * bytes, headers included, from free lists.  Sizes are then rounded up
+ * to 16, which keeps the blocks 16-byte aligned.  Page guards always
+ * map their own pages.
+ */
+
+static int use_slab = 0;
+
+
+/*
+ * The event log (see memcheck.h), written when MEMCHECK_LOG names a
+ * file.  Each shard buffers the events of its blocks, under its lock,
+ * so logging an event takes no more than reading the time stamp counter
+ * and filling in a record.  (Reading the clock can take longer than all
+ * the rest, so it is only read when a buffer is written out.)  The
+ * events of one block all go to the shard of its site, and are in order
+ * there.
+ */
+
+static int log_fd = -1;
+static struct timespec log_start;
+
+/* Events a shard buffers before writing them out, with the clock record
+ * that follows them. */
+#define LOG_EVENTS 4096
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOG_TICKS()  ((unsigned long)__builtin_ia32_rdtsc())
+#else
+#define LOG_TICKS()  log_clock()
+#endif
+
+
+/**********************************************************************
+ *
+ * Low-level functions for managing the memory pool list.
+ *
+ **********************************************************************/
+
+/*
+ * Write 'len' bytes to the event log, or abort if they can't be written.
+ */
+
+static void
+write_log(const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    ssize_t done;
+
+    while (len > 0)
+    {
+        done = write(log_fd, p, len);
+
+        if (done < 0)
+        {
+            log_fd = -1;    /* nothing more is logged on the way out */
+            fprintf(stderr, "ERROR: can't write the memory log!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+
+        p   += done;
+        len -= (size_t)done;
+    }
+}
+
+
+/*
+ * Return the nanoseconds since the event log was opened.
+ */
+
+static unsigned long
+log_clock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)(now.tv_sec - log_start.tv_sec) * 1000000000UL +
+           (unsigned long)now.tv_nsec - (unsigned long)log_start.tv_nsec;
+}
+
+
+/*
+ * Create the event log 'path' and write its first record.
+ */
+
+static void
+open_log(char *path)
+{
+    memcheck_event e;
+
+    log_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (log_fd < 0)
+    {
+        fprintf(stderr, "ERROR: can't create the memory log %s!  "
+                        "Aborting...\n", path);
+        exit(1);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &log_start);
+    memset(&e, 0, sizeof(e));
+    e.time = LOG_TICKS();
+    e.op   = MEMLOG_START;
+    e.addr = MEMLOG_MAGIC;
+    e.size = sample_interval;
+    write_log(&e, sizeof(e));
+}
+
+
+/*
+ * Write out the events buffered by shard 's', which must be locked,
+ * followed by a clock record.
+ */
+
+static void
+flush_log(pool_shard *s)
+{
+    memcheck_event *e;
+
+    if (s->log_count > 0)
+    {
+        e = &s->log[s->log_count++];
+        memset(e, 0, sizeof(memcheck_event));
+        e->time = LOG_TICKS();
+        e->size = log_clock();
+        e->op   = MEMLOG_CLOCK;
+        write_log(s->log, s->log_count * sizeof(memcheck_event));
+        s->log_count = 0;
+    }
+}
+
+
+/*
+ * Write out the events buffered by every shard.  Every shard must be
+ * locked.
+ */
+
+static void
+flush_all_logs(void)
+{
+    int i;
+
+    if (log_fd < 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < NSHARDS; i++)
+    {
+        flush_log(&shards[i].s);
+    }
+}
+
+
+/*
+ * Add an event to the buffer of shard 's', which must be locked, timed
+ * now.  The arguments are the fields of the record.  Only called while
+ * the log is open.
+ */
+
+static void
+log_event(pool_shard *s, unsigned int op, unsigned long addr,
+          unsigned long old_addr, size_t size, unsigned int site)
+{
+    memcheck_event *e;
+
+    if (s->log == NULL)
+    {
+        s->log = (memcheck_event *)malloc((LOG_EVENTS + 1) *
+                                          sizeof(memcheck_event));
+
+        if (s->log == NULL)
+        {
+            fprintf(stderr, "ERROR: memory allocation failed!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+    }
+    else if (s->log_count == LOG_EVENTS)
+    {
+        flush_log(s);
+    }
+
+    e = &s->log[s->log_count++];
+    e->time     = LOG_TICKS();
+    e->addr     = addr;
+    e->old_addr = old_addr;
+    e->size     = size;
+    e->site     = site;
+    e->op       = op;
+}
+
+
+/*
+ * Log the creation of call site 'site' in shard 's', which must be
+ * locked: its record, then its file name in the records after it (file
+ * names being far shorter than a buffer).
+ */
+
+static void
+log_site(pool_shard *s, mem_site *site)
+{
+    size_t len = strlen(site->filename);
+    size_t nrecords = (len + sizeof(memcheck_event) - 1) /
+                      sizeof(memcheck_event);
+
+    if (s->log_count + 1 + nrecords > LOG_EVENTS)
+    {
+        flush_log(s);
+    }
+
+    log_event(s, MEMLOG_SITE, (unsigned long)site->lineno, 0, len, site->id);
+    memset(&s->log[s->log_count], 0, nrecords * sizeof(memcheck_event));
+    memcpy(&s->log[s->log_count], site->filename, len);
+    s->log_count += nrecords;
+}
+
+
+/*
+ * Make every shard's list empty, and read the settings from the
+ * environment.
+ */
+
+static void
+init_shards(void)
+{
+    char *sample = getenv("MEMCHECK_SAMPLE");
+    char *mode   = getenv("MEMCHECK_GUARD");
+    char *log    = getenv("MEMCHECK_LOG");
+    char *alloc  = getenv("MEMCHECK_BACKEND");
+    int i;
+
+    for (i = 0; i < NSHARDS; i++)
+    {
+#ifdef MEMCHECK_THREADS
+        pthread_mutex_init(&shards[i].s.lock, NULL);
+#endif
+        shards[i].s.pool.next = shards[i].s.pool.prev = &shards[i].s.pool;
+    }
+
+    if (sample != NULL)
+    {
+        sample_interval = (size_t)atol(sample);
+    }
+
+    if (mode == NULL || strcmp(mode, "none") == 0)
+    {
+        guard = GUARD_NONE;
+    }
+    else if (strcmp(mode, "canary") == 0)
+    {
+        guard = GUARD_CANARY;
+    }
+    else if (strcmp(mode, "page") == 0)
+    {
+        /* MAP_ANONYMOUS isn't POSIX; mapping /dev/zero is the same. */
+        guard     = GUARD_PAGE;
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+        zero_fd   = open("/dev/zero", O_RDWR);
+
+        if (zero_fd < 0)
+        {
+            fprintf(stderr, "ERROR: can't open /dev/zero for guard pages!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: MEMCHECK_GUARD must be none, canary or "
+                        "page!  Aborting...\n");
+        exit(1);
+    }
+
+    if (alloc == NULL || strcmp(alloc, "malloc") == 0)
+    {
+        use_slab = 0;
+    }
+    else if (strcmp(alloc, "slab") == 0)
+    {
+        use_slab = 1;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: MEMCHECK_BACKEND must be malloc or slab!  "
+                        "Aborting...\n");
+        exit(1);
+    }
+
+    if (log != NULL)
+    {
+        open_log(log);
+    }
+}
+
+
+/*
+ * Return the calling thread's home shard, giving it one the first time.
+ */
+
+static pool_shard *
+get_home_shard(void)
+{
+    int seen;
+
+    if (home_shard < 0)
+    {
+#ifdef MEMCHECK_THREADS
+        pthread_once(&shards_once, init_shards);
+        seen = __sync_fetch_and_add(&nthreads_seen, 1);
+#else
+        seen = nthreads_seen++;
+
+        if (seen == 0)
+        {
+            init_shards();
+        }
+#endif
+        home_shard    = seen % NSHARDS;
+        sample_random = 0x9E3779B97F4A7C15UL * (unsigned long)(seen + 1);
+    }
+
+    return &shards[home_shard].s;
+}
+
+
+/*
+ * Lock every shard (in order, so two callers can't deadlock) or unlock
+ * them all, for a consistent view of the whole pool.
+ */
+
+static void
+lock_all_shards(void)
+{
+    int i;
+
+    get_home_shard();   /* the shards may not be set up yet */
+
+    for (i = 0; i < NSHARDS; i++)
+    {
+        LOCK_SHARD(&shards[i].s);
+    }
+}
+
+
+static void
+unlock_all_shards(void)
+{
+    int i;
+
+    for (i = NSHARDS - 1; i >= 0; i--)
+    {
+        UNLOCK_SHARD(&shards[i].s);
+    }
+}
+
+
+/*
+ * Return the natural logarithm of 'x' > 0.  Only needed once per
+ * sample, so it is computed here rather than making every program that
+ * uses memcheck link the math library: 'x' is scaled into [1/2, 1] by
+ * powers of two, and ln x = 2 atanh((x - 1) / (x + 1)) summed as a
+ * series, good to about 1e-7.
+ */
+
+static double
+log_of(double x)
+{
+    double t, t2;
+    int e = 0;
+
+    while (x < 0.5)
+    {
+        x *= 2;
+        e--;
+    }
+
+    while (x > 1)
+    {
+        x /= 2;
+        e++;
+    }
+
+    t  = (x - 1) / (x + 1);
+    t2 = t * t;
+
+    return 2 * t * (1 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 * (1.0 / 7 +
+           t2 * (1.0 / 9 + t2 * (1.0 / 11)))))) + e * 0.6931471805599453;
+}
+
+
+/*
+ * Return 1 - exp(-x) for x >= 0, the chance that a block of x sample
+ * intervals is sampled.  Small x uses the series, which doesn't lose
+ * precision to the subtraction; larger x halves until small, takes the
+ * series for exp and squares back.
+ */
+
+static double
+sample_probability(double x)
+{
+    double e;
+    int k = 0, i;
+
+    if (x > 40)
+    {
+        return 1;
+    }
+
+    if (x < 0.25)
+    {
+        return x * (1 - x / 2 * (1 - x / 3 * (1 - x / 4 * (1 - x / 5 *
+               (1 - x / 6)))));
+    }
+
+    for (; x > 0.25; k++)
+    {
+        x /= 2;
+    }
+
+    e = 1 - x * (1 - x / 2 * (1 - x / 3 * (1 - x / 4 * (1 - x / 5 *
+        (1 - x / 6)))));
+
+    for (i = 0; i < k; i++)
+    {
+        e *= e;
+    }
+
+    return 1 - e;
+}
+
+
+/*
+ * Decide whether to track an allocation of 'nbytes' by the calling
+ * thread: return 1 if a sample point falls in its bytes.
+ */
+
+static int
+take_sample(size_t nbytes)
+{
+    double u;
+
+    if (sample_interval == 0)
+    {
+        return 1;
+    }
+
+    if (nbytes < bytes_until_sample)
+    {
+        bytes_until_sample -= nbytes;
+        return 0;
+    }
+
+    /* xorshift64*, the top 53 bits as a uniform number in (0, 1) */
+    sample_random ^= sample_random >> 12;
+    sample_random ^= sample_random << 25;
+    sample_random ^= sample_random >> 27;
+    u = ((sample_random * 0x2545F4914F6CDD1DUL >> 11) + 0.5) /
+        9007199254740992.0;
+
+    bytes_until_sample = (size_t)(-log_of(u) * sample_interval) + 1;
+    return 1;
+}
+
+
+/*
+ * Return the weight for the node of a tracked block of 'nbytes'.
+ */
+
+static unsigned long
+node_weight(size_t nbytes)
+{
+    if (sample_interval == 0)
+    {
+        return WEIGHT_ONE;
+    }
+
+    return (unsigned long)(WEIGHT_ONE /
+                           sample_probability((double)nbytes /
+                                              sample_interval) + 0.5);
+}
+
+
+/*
+ * Return the slot where probing for a site starts.
+ */
+
+static size_t
+site_slot(pool_shard *s, char *filename, int lineno)
+{
+    unsigned long h = (unsigned long)filename ^ (unsigned long)lineno;
+
+    return (size_t)((h * 0x9E3779B97F4A7C15UL) >> 20) & (s->sites_size - 1);
+}
+
+
+/*
+ * Return the slot holding the site for 'filename' and 'lineno', or the
+ * empty slot where it would go.  The same file name may be a different
+ * string literal in each source file that uses it; those sites are only
+ * merged when the profile is printed.
+ */
+
+static mem_site **
+probe_site(pool_shard *s, char *filename, int lineno)
+{
+    size_t i;
+
+    for (i = site_slot(s, filename, lineno); s->sites[i] != NULL;
+         i = (i + 1) & (s->sites_size - 1))
+    {
+        if (s->sites[i]->filename == filename &&
+            s->sites[i]->lineno == lineno)
+        {
+            break;
+        }
+    }
+
+    return &s->sites[i];
+}
+
+
+/*
+ * Return the site record in shard 's' for an allocation, creating it if
+ * needed.  The shard must be locked.
+ */
+
+static mem_site *
+find_site(pool_shard *s, char *filename, int lineno)
+{
+    mem_site **old, **slot;
+    size_t old_size, i;
+
+    if (2 * (s->sites_count + 1) > s->sites_size)
+    {
+        old = s->sites;
+        old_size = s->sites_size;
+        s->sites_size = old_size == 0 ? MIN_SITES : 2 * old_size;
+        s->sites = (mem_site **)calloc(s->sites_size, sizeof(mem_site *));
+
+        if (s->sites == NULL)
+        {
+            fprintf(stderr, "ERROR: memory allocation failed!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+
+        for (i = 0; i < old_size; i++)
+        {
+            if (old[i] != NULL)
+            {
+                *probe_site(s, old[i]->filename, old[i]->lineno) = old[i];
+            }
+        }
+
+        free(old);
+    }
+
+    slot = probe_site(s, filename, lineno);
+
+    if (*slot == NULL)
+    {
+        *slot = (mem_site *)calloc(1, sizeof(mem_site));
+
+        if (*slot == NULL)
+        {
+            fprintf(stderr, "ERROR: memory allocation failed!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+
+        (*slot)->filename = filename;
+        (*slot)->lineno   = lineno;
+        (*slot)->shard    = (int)(((padded_shard *)s) - shards);
+#ifdef MEMCHECK_THREADS
+        (*slot)->id       = __sync_fetch_and_add(&nsites_made, 1);
+#else
+        (*slot)->id       = nsites_made++;
+#endif
+        s->sites_count++;
+
+        if (log_fd >= 0)
+        {
+            log_site(s, *slot);
+        }
+    }
+
+    return *slot;
+}
+
+
+/*
+ * Free every site record of a shard.  Only done once no block is live,
+ * since each header points to its site.
+ */
+
+static void
+free_all_sites(pool_shard *s)
+{
+    size_t i;
+
+    for (i = 0; i < s->sites_size; i++)
+    {
+        free(s->sites[i]);
+    }
+
+    free(s->sites);
+    s->sites       = NULL;
+    s->sites_size  = 0;
+    s->sites_count = 0;
+    s->live_bytes  = 0;
+    s->peak_bytes  = 0;
+}
+
+
+/*
+ * Return the number of canary bytes after the block of node 'n'.
+ */
+
+static size_t
+canary_size(mem_node *n)
+{
+    size_t end;
+
+    if (guard == GUARD_CANARY)
+    {
+        return CANARY_SIZE;
+    }
+    else if (guard == GUARD_PAGE)
+    {
+        end = (size_t)BLOCK_OF(n) + n->nbytes;
+        return ROUND_UP(end, page_size) - end;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Fill in the canary bytes after the block of node 'n', or check them:
+ * canary_intact() returns 0 if one was overwritten.
+ */
+
+static void
+set_canary(mem_node *n)
+{
+    if (guard == GUARD_NONE)
+    {
+        return;
+    }
+
+    memset((char *)BLOCK_OF(n) + n->nbytes, CANARY_BYTE, canary_size(n));
+}
+
+
+static int
+canary_intact(mem_node *n)
+{
+    unsigned char *p = (unsigned char *)BLOCK_OF(n) + n->nbytes;
+    size_t i, size;
+
+    if (guard == GUARD_NONE)
+    {
+        return 1;
+    }
+
+    size = canary_size(n);
+
+    for (i = 0; i < size; i++)
+    {
+        if (p[i] != CANARY_BYTE)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*
+ * Explain a failure to map a guarded block, which is more often the
+ * limit on the number of mappings than a lack of memory.
+ */
+
+static void
+map_failed(void)
+{
+    fprintf(stderr, "ERROR: can't map a block with a guard page.  Each "
+                    "live block takes two\nmemory mappings, which the "
+                    "system limits (see /proc/sys/vm/max_map_count).\n");
+}
+
+
+/*
+ * Return the node of a new block of 'nbytes' on pages of its own, ending
+ * before a guard page, aligned to 'alignment'; or NULL if there is no
+ * memory.  Mapped pages are zeroed.
+ */
+
+static mem_node *
+new_page_node(size_t nbytes, size_t alignment)
+{
+    char *map, *block, *end;
+    size_t len;
+    mem_node *n;
+
+    if (nbytes > (size_t)-1 - HEADER_SIZE - alignment - 2 * page_size)
+    {
+        return NULL;
+    }
+
+    len = ROUND_UP(HEADER_SIZE + alignment - 1 + nbytes, page_size) +
+          page_size;
+    map = (char *)mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       zero_fd, 0);
+
+    if (map == (char *)MAP_FAILED)
+    {
+        map_failed();
+        return NULL;
+    }
+
+    /* The block goes as near the last page as its alignment allows; the
+     * page after it becomes the guard, and any pages past that (when the
+     * alignment is more than a page) are given back. */
+    block = map + len - page_size - nbytes;
+    block -= (size_t)block & (alignment - 1);
+    end = map + ROUND_UP((size_t)(block + nbytes - map), page_size);
+
+    if (end + page_size < map + len)
+    {
+        munmap(end + page_size, (size_t)(map + len - end - page_size));
+    }
+
+    if (mprotect(end, page_size, PROT_NONE) != 0)
+    {
+        munmap(map, (size_t)(end + page_size - map));
+        map_failed();
+        return NULL;
+    }
+
+    n = NODE_OF(block);
+    n->offset = (unsigned int)((char *)n - map);
+    n->nbytes = nbytes;
+    set_canary(n);
+    return n;
+}
+
+
+/*
+ * Return the node of a new block of 'nbytes', aligned to 'alignment' (a
+ * power of two, at least 16) and laid out for the guard mode, with its
+ * 'offset', 'nbytes' and canary filled in; or NULL if there is no
+ * memory.  The block is zeroed if 'zero' is nonzero.
+ */
+
+static mem_node *
+new_node(size_t nbytes, size_t alignment, int zero)
+{
+    size_t slide = alignment > 16 ? alignment - 1 : 0, extra, size;
+    char *mem, *block;
+    mem_node *n;
+
+    get_home_shard();   /* sets up the shards and modes, if not yet */
+    extra = guard == GUARD_CANARY ? CANARY_SIZE : 0;
+
+    if (guard == GUARD_PAGE)
+    {
+        return new_page_node(nbytes, alignment);
+    }
+
+    /* The header and the rest are added to the size, and it may be
+     * rounded up to 16, so check the sum can't wrap. */
+    if (nbytes > (size_t)-1 - HEADER_SIZE - slide - extra - 15)
+    {
+        return NULL;
+    }
+
+    size = HEADER_SIZE + slide + nbytes + extra;
+
+    if (use_slab)
+    {
+        size = ROUND_UP(size, 16);
+        mem  = (char *)(zero ? slab_calloc(1, size) : slab_malloc(size));
+    }
+    else
+    {
+        mem = (char *)(zero ? calloc(1, size) : malloc(size));
+    }
+
+    if (mem == NULL)
+    {
+        return NULL;
+    }
+
+    block = mem + HEADER_SIZE;
+    block += (0 - (size_t)block) & (alignment - 1);
+
+    n = NODE_OF(block);
+    n->offset = (unsigned int)((char *)n - mem);
+    n->nbytes = nbytes;
+    set_canary(n);
+    return n;
+}
+
+
+/*
+ * Make the guarded block at 'map', whose pages before the guard page
+ * take 'len' bytes, read-only, and put it in the quarantine, unmapping
+ * the block it displaces.
+ */
+
+static void
+quarantine_pages(char *map, size_t len)
+{
+    quarantined old;
+
+    mprotect(map, len, PROT_READ);
+
+#ifdef MEMCHECK_THREADS
+    pthread_mutex_lock(&quarantine_lock);
+#endif
+    old = quarantine[quarantine_next];
+    quarantine[quarantine_next].map = map;
+    quarantine[quarantine_next].len = len;
+    quarantine_next = (quarantine_next + 1) % QUARANTINE_BLOCKS;
+#ifdef MEMCHECK_THREADS
+    pthread_mutex_unlock(&quarantine_lock);
+#endif
+
+    if (old.map != NULL)
+    {
+        munmap(old.map, old.len + page_size);
+    }
+}
+
+
+/*
+ * Give back the memory of node 'n' and its block.  Its header must no
+ * longer hold a live magic number.
+ */
+
+static void
+release_node(mem_node *n)
+{
+    if (guard == GUARD_PAGE)
+    {
+        quarantine_pages((char *)MEM_OF(n),
+                         ROUND_UP(n->offset + HEADER_SIZE + n->nbytes,
+                                  page_size));
+    }
+    else if (use_slab)
+    {
+        slab_free(MEM_OF(n));
+    }
+    else
+    {
+        free(MEM_OF(n));
+    }
+}
+
+
+/*
+ * Resize the block of node 'n' to 'size' bytes, keeping its contents and
+ * the rest of its header, and return the node's new address; or return
+ * NULL if there is no memory, leaving 'n' as it was.
+ */
+
+static mem_node *
+resize_node(mem_node *n, size_t size)
+{
+    size_t offset = n->offset;
+    size_t extra = guard == GUARD_CANARY ? CANARY_SIZE : 0;
+    char *mem;
+    mem_node *m;
+
+    if (guard == GUARD_PAGE)
+    {
+        m = new_page_node(size, 16);
+
+        if (m != NULL)
+        {
+            offset = m->offset;
+            memcpy(m, n, HEADER_SIZE + (size < n->nbytes ? size : n->nbytes));
+            m->offset = (unsigned int)offset;
+            m->nbytes = size;
+            n->magic  = 0;
+            release_node(n);
+        }
+
+        return m;
+    }
+
+    if (size > (size_t)-1 - HEADER_SIZE - offset - extra - 15)
+    {
+        return NULL;
+    }
+
+    if (use_slab)
+    {
+        mem = (char *)slab_realloc(MEM_OF(n),
+                                   ROUND_UP(offset + HEADER_SIZE + size +
+                                            extra, 16));
+    }
+    else
+    {
+        mem = (char *)realloc(MEM_OF(n), offset + HEADER_SIZE + size + extra);
+    }
+
+    if (mem == NULL)
+    {
+        return NULL;
+    }
+
+    m = (mem_node *)(mem + offset);
+    m->nbytes = size;
+    set_canary(m);
+    return m;
+}
+
+
+/*
+ * Start tracking the block of node 'n', whose 'offset' and 'nbytes' are
+ * filled in: give it its weight and site, count it, and link it into
+ * the front of the calling thread's shard of the memory pool.
+ */
+
+static void
+track_mem_node(mem_node *n, unsigned long weight, char *filename, int lineno)
+{
+    pool_shard *s = get_home_shard();
+    size_t wbytes = WEIGHTED(n->nbytes, weight);
+
+    n->magic  = NODE_MAGIC;
+    n->weight = weight;
+
+    LOCK_SHARD(s);
+    n->site = find_site(s, filename, lineno);
+
+    n->site->live_bytes  += wbytes;
+    n->site->live_count  += WEIGHTED(1, weight);
+    n->site->total_bytes += wbytes;
+    n->site->nallocs     += WEIGHTED(1, weight);
+
+    if (n->site->live_bytes > n->site->peak_bytes)
+    {
+        n->site->peak_bytes = n->site->live_bytes;
+    }
+
+    s->live_bytes += wbytes;
+
+    if (s->live_bytes > s->peak_bytes)
+    {
+        s->peak_bytes = s->live_bytes;
+    }
+
+    n->prev = &s->pool;
+    n->next = s->pool.next;
+    s->pool.next->prev = n;
+    s->pool.next = n;
+
+    if (log_fd >= 0)
+    {
+        log_event(s, MEMLOG_ALLOC, (unsigned long)BLOCK_OF(n), 0, n->nbytes,
+                  n->site->id);
+    }
+
+    UNLOCK_SHARD(s);
+}
+
+
+/*
+ * Track the new node 'n' from new_node(), unless sampling passes it
+ * over.  Return the user's block, which follows the header.
+ */
+
+void *
+allocate_mem_node(mem_node *n, char *filename, int lineno)
+{
+#if DEBUG == 1
+    fprintf(stderr, "Allocating %d bytes of memory at %p\n",
+            (int)n->nbytes, BLOCK_OF(n));
+#endif
+
+    /* The filename is a string literal (__FILE__), so it isn't copied. */
+    if (take_sample(n->nbytes))
+    {
+        track_mem_node(n, node_weight(n->nbytes), filename, lineno);
+    }
+    else
+    {
+        n->magic = UNTRACKED_MAGIC;
+    }
+
+    return BLOCK_OF(n);
+}
+
+
+/*
+ * Free a memory node (which also frees its block).  The node must
+ * already be unlinked from the pool.
+ */
+
+void
+free_mem_node(mem_node *n)
+{
+    if (n != NULL)
+    {
+        if (n->magic != NODE_MAGIC)
+        {
+            fprintf(stderr, "ERROR: invalid node at: %p\n", (void *)n);
+            return;
+        }
+
+#if DEBUG == 1
+        fprintf(stderr, "Freeing memory at %p\n", BLOCK_OF(n));
+#endif
+
+        n->magic = 0;   /* so a second free of the block is caught */
+        release_node(n);
+    }
+}
+
+
+/*
+ * Unlink a memory node from the pool and free it.  The node's shard is
+ * the one its site belongs to, which need not be the caller's.
+ */
+
+void
+free_mem_node_and_adjust_pool(mem_node *n)
+{
+    pool_shard *s = &shards[n->site->shard].s;
+
+    LOCK_SHARD(s);
+
+    /* Checked again under the lock, in case another thread got here
+     * first with the same block. */
+    if (n->magic != NODE_MAGIC)
+    {
+        UNLOCK_SHARD(s);
+        fprintf(stderr, "ERROR: invalid node at: %p\n", (void *)n);
+        return;
+    }
+
+    n->site->live_bytes -= WEIGHTED(n->nbytes, n->weight);
+    n->site->live_count -= WEIGHTED(1, n->weight);
+    s->live_bytes -= WEIGHTED(n->nbytes, n->weight);
+
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    n->magic = 0;   /* so a second free of the block is caught */
+
+    if (log_fd >= 0)
+    {
+        log_event(s, MEMLOG_FREE, (unsigned long)BLOCK_OF(n), 0, n->nbytes,
+                  n->site->id);
+    }
+
+    UNLOCK_SHARD(s);
+
+#if DEBUG == 1
+    fprintf(stderr, "Freeing memory at %p\n", BLOCK_OF(n));
+#endif
+
+    release_node(n);
+}
+
+
+/*
+ * Free all the memory nodes from the pool, and the call sites with them.
+ * Every shard must be locked.
+ */
+
+void
+free_all_mem_nodes(void)
+{
+    mem_node *n, *next;
+    pool_shard *s;
+    int i;
+
+    for (i = 0; i < NSHARDS; i++)
+    {
+        s = &shards[i].s;
+
+        for (n = s->pool.next; n != &s->pool; n = next)
+        {
+            next = n->next;
+            free_mem_node(n);
+        }
+
+        s->pool.next = s->pool.prev = &s->pool;
+        free_all_sites(s);
+    }
+}
+
+
+/*
+ * Return the node that corresponds to the address 'addr', or NULL if
+ * 'addr' isn't a live block.  Only the header in front of 'addr' is
+ * checked, so a pointer that memcheck never handed out is read a few
+ * words before its start.
+ */
+
+mem_node *
+find_node(void *addr)
+{
+    mem_node *n;
+
+    if (addr == NULL)
+    {
+        return NULL;
+    }
+
+    n = NODE_OF(addr);
+    return n->magic == NODE_MAGIC ? n : NULL;
+}
+
+
+/*
+ * A debugging function to print the contents of the memory pool
+ * linked list.
+ */
+
+void
+dump_pool(void)
+{
+    mem_node *n, *pool;
+    int i;
+
+    lock_all_shards();
+
+    for (i = 0; i < NSHARDS; i++)
+    {
+        pool = &shards[i].s.pool;
+
+        for (n = pool->next; n != pool; n = n->next)
+        {
+            fprintf(stderr, "NODE --------\n");
+            fprintf(stderr, "location: %p\n", (void *)n);
+            fprintf(stderr, "addr: %p\n", BLOCK_OF(n));
+            fprintf(stderr, "nbytes: %d\n", (int)n->nbytes);
+            fprintf(stderr, "filename: %s\n", n->site->filename);
+            fprintf(stderr, "line number: %d\n", n->site->lineno);
+            fprintf(stderr, "shard: %d\n", i);
+            fprintf(stderr, "prev: %p\n", (void *)n->prev);
+            fprintf(stderr, "next: %p\n", (void *)n->next);
+            fprintf(stderr, "\n");
+        }
+    }
+
+    unlock_all_shards();
+}
+
+
+/**********************************************************************
+ *
+ * User-level functions.
+ *
+ * NOTE: Normally, the user will not use these functions, but will
+ *       use 'malloc' and 'calloc' wrappers defined in "memcheck.h".
+ *
+ **********************************************************************/
+
+
+/*
+ * Allocate 'size' bytes of memory.  Also add the address, filename, and line
+ * number as a new node in the memory pool.  The node and the block come
+ * from a single call to malloc (or mmap, with guard pages).
+ */
+
+void *
+checked_malloc_fn(size_t size, char *filename, int lineno)
+{
+    mem_node *n = new_node(size, 16, 0);
+
+    if (n == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    return allocate_mem_node(n, filename, lineno);
+}
+
+
+/*
+ * This function is the same as 'checked_malloc' except that it has
+ * a different signature (corresponding to 'calloc' in the first two
+ * arguments) and zeroes out all the allocated memory.
+ */
+
+void *
+checked_calloc_fn(size_t nmemb, size_t size, char *filename, int lineno)
+{
+    mem_node *n = NULL;
+
+    if (size == 0 || nmemb <= (size_t)-1 / size)
+    {
+        n = new_node(nmemb * size, 16, 1);
+    }
+
+    if (n == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    return allocate_mem_node(n, filename, lineno);
+}
+
+
+/*
+ * Report an attempt to 'what' (free or realloc) a pointer that isn't a
+ * live block, and abort.
+ */
+
+static void
+invalid_pointer(char *what, void *ptr, char *filename, int lineno)
+{
+    fprintf(stderr,
+            "ERROR: invalid attempt to %s unallocated memory at %p "
+            "in file: %s, line: %d\n", what, ptr, filename, lineno);
+    fprintf(stderr, "Aborting...\n");
+    lock_all_shards();
+    flush_all_logs();
+    free_all_mem_nodes();
+    exit(1);
+}
+
+
+/*
+ * Check the canary bytes of node 'n' as the program is about to 'what'
+ * (free or realloc) its block, and if one was overwritten, report the
+ * overrun and abort.
+ */
+
+static void
+check_canary(mem_node *n, char *what, char *filename, int lineno)
+{
+    if (canary_intact(n))
+    {
+        return;
+    }
+
+    fprintf(stderr, "ERROR: buffer overrun past the %lu bytes at %p",
+            (unsigned long)n->nbytes, BLOCK_OF(n));
+
+    if (n->magic == NODE_MAGIC)
+    {
+        fprintf(stderr, " allocated in file: %s, line: %d",
+                n->site->filename, n->site->lineno);
+    }
+
+    fprintf(stderr, ", found on %s in file: %s, line: %d\n",
+            what, filename, lineno);
+    fprintf(stderr, "Aborting...\n");
+    lock_all_shards();
+    flush_all_logs();
+    free_all_mem_nodes();
+    exit(1);
+}
+
+
+/*
+ * Free a pointer that was previously allocated by 'checked_malloc()'.  If
+ * the memory being freed is not found in the memory pool, print an error
+ * message and abort.
+ */
+
+void
+checked_free_fn(void *ptr, char *filename, int lineno)
+{
+    mem_node *n;
+
+    /* Blocks that sampling left untracked are only in their header. */
+    if (ptr != NULL && NODE_OF(ptr)->magic == UNTRACKED_MAGIC)
+    {
+        n = NODE_OF(ptr);
+        check_canary(n, "free", filename, lineno);
+        n->magic = 0;
+        release_node(n);
+        return;
+    }
+
+    n = find_node(ptr);
+
+    if (n == NULL)
+    {
+        invalid_pointer("free", ptr, filename, lineno);
+    }
+    else
+    {
+        check_canary(n, "free", filename, lineno);
+        free_mem_node_and_adjust_pool(n);
+    }
+}
+
+
+/*
+ * Resize a block like realloc().  The node moves with its block and is
+ * updated where it is: its neighbours in the pool are pointed at its new
+ * address and its site's counts adjusted, all under its shard's lock.
+ * The site stays that of the first allocation.  When sampling, a
+ * sampled block is reweighted for its new size, and the bytes an
+ * untracked block grows by count towards the next sample, which starts
+ * tracking it at this call.  A NULL pointer is allocated, and a size of
+ * 0 frees the block and returns NULL, as the GNU C library does.
+ */
+
+void *
+checked_realloc_fn(void *ptr, size_t size, char *filename, int lineno)
+{
+    mem_node *n, *m;
+    mem_site *site;
+    pool_shard *s;
+    size_t old_size, old_bytes, new_bytes;
+    unsigned long weight;
+
+    if (ptr == NULL)
+    {
+        return checked_malloc_fn(size, filename, lineno);
+    }
+
+    if (size == 0)
+    {
+        checked_free_fn(ptr, filename, lineno);
+        return NULL;
+    }
+
+    n = NODE_OF(ptr);
+    old_size = n->nbytes;
+
+    if (n->magic == UNTRACKED_MAGIC)
+    {
+        check_canary(n, "realloc", filename, lineno);
+        n = resize_node(n, size);
+
+        if (n == NULL)
+        {
+            fprintf(stderr, "ERROR: memory allocation failed!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+
+        if (size > old_size && take_sample(size - old_size))
+        {
+            track_mem_node(n, node_weight(size), filename, lineno);
+        }
+
+        return BLOCK_OF(n);
+    }
+
+    n = find_node(ptr);
+
+    if (n == NULL)
+    {
+        invalid_pointer("realloc", ptr, filename, lineno);
+    }
+
+    check_canary(n, "realloc", filename, lineno);
+    site = n->site;
+    s = &shards[site->shard].s;
+    LOCK_SHARD(s);
+
+    /* As in free_mem_node_and_adjust_pool(). */
+    if (n->magic != NODE_MAGIC)
+    {
+        UNLOCK_SHARD(s);
+        invalid_pointer("realloc", ptr, filename, lineno);
+    }
+
+    m = resize_node(n, size);
+
+    if (m == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    n = m;
+    n->prev->next = n;
+    n->next->prev = n;
+
+    weight = n->weight;
+
+    if (weight != WEIGHT_ONE && sample_interval != 0)
+    {
+        weight = node_weight(size);
+    }
+
+    old_bytes = WEIGHTED(old_size, n->weight);
+    new_bytes = WEIGHTED(size, weight);
+
+    site->live_count = site->live_count - WEIGHTED(1, n->weight) +
+                       WEIGHTED(1, weight);
+    site->live_bytes = site->live_bytes - old_bytes + new_bytes;
+    s->live_bytes    = s->live_bytes - old_bytes + new_bytes;
+    n->weight = weight;
+
+    if (new_bytes > old_bytes)
+    {
+        site->total_bytes += new_bytes - old_bytes;
+
+        if (site->live_bytes > site->peak_bytes)
+        {
+            site->peak_bytes = site->live_bytes;
+        }
+
+        if (s->live_bytes > s->peak_bytes)
+        {
+            s->peak_bytes = s->live_bytes;
+        }
+    }
+
+    if (log_fd >= 0)
+    {
+        log_event(s, MEMLOG_REALLOC, (unsigned long)BLOCK_OF(n),
+                  (unsigned long)ptr, size, site->id);
+    }
+
+    UNLOCK_SHARD(s);
+    return BLOCK_OF(n);
+}
+
+
+/*
+ * Copy a string into a new block, like strdup().
+ */
+
+char *
+checked_strdup_fn(const char *s, char *filename, int lineno)
+{
+    size_t len = strlen(s);
+    char *copy = (char *)checked_malloc_fn(len + 1, filename, lineno);
+
+    memcpy(copy, s, len + 1);
+    return copy;
+}
+
+
+/*
+ * Copy at most 'n' characters of a string into a new block and end it
+ * with a null character, like strndup().  Only the characters copied
+ * are read, so 's' need not be null-terminated.
+ */
+
+char *
+checked_strndup_fn(const char *s, size_t n, char *filename, int lineno)
+{
+    size_t len = 0;
+    char *copy;
+
+    while (len < n && s[len] != '\0')
+    {
+        len++;
+    }
+
+    copy = (char *)checked_malloc_fn(len + 1, filename, lineno);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+
+/*
+ * Allocate 'size' bytes aligned to 'alignment' (a power of two), like
+ * aligned_alloc().  The underlying allocation has room to slide the
+ * header and block up to the alignment; the header records how far, so
+ * the block is freed like any other.
+ */
+
+void *
+checked_aligned_alloc_fn(size_t alignment, size_t size,
+                         char *filename, int lineno)
+{
+    mem_node *n;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+        alignment > 0x80000000UL)
+    {
+        fprintf(stderr, "ERROR: invalid alignment %lu in file: %s, "
+                        "line: %d\n", (unsigned long)alignment,
+                filename, lineno);
+        fprintf(stderr, "Aborting...\n");
+        exit(1);
+    }
+
+    n = new_node(size, alignment < 16 ? 16 : alignment, 0);
+
+    if (n == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    return allocate_mem_node(n, filename, lineno);
+}
+
+
+/*
+ * Track about one allocation per 'interval' bytes from now on, or every
+ * allocation for 0.  Blocks already allocated keep their weights, so
+ * this may be changed at any time.
+ */
+
+void
+set_memory_sampling(size_t interval)
+{
+    lock_all_shards();      /* also reads MEMCHECK_SAMPLE, if not yet */
+    sample_interval    = interval;
+    bytes_until_sample = 0;
+
+    if (log_fd >= 0)
+    {
+        log_event(get_home_shard(), MEMLOG_SAMPLE, 0, 0, interval, 0);
+    }
+
+    unlock_all_shards();
+}
+
+
+/*
+ * qsort() comparisons for call sites: by file and line, by bytes
+ * allocated, and by bytes still live (largest first).
+ */
+
+static int
+compare_site_location(const void *a, const void *b)
+{
+    const mem_site *x = (const mem_site *)a, *y = (const mem_site *)b;
+    int c = strcmp(x->filename, y->filename);
+
+    return c != 0 ? c : (x->lineno > y->lineno) - (x->lineno < y->lineno);
+}
+
+
+static int
+compare_site_total(const void *a, const void *b)
+{
+    const mem_site *x = (const mem_site *)a, *y = (const mem_site *)b;
+
+    return (x->total_bytes < y->total_bytes) -
+           (x->total_bytes > y->total_bytes);
+}
+
+
+static int
+compare_site_live(const void *a, const void *b)
+{
+    const mem_site *x = (const mem_site *)a, *y = (const mem_site *)b;
+
+    return (x->live_bytes < y->live_bytes) - (x->live_bytes > y->live_bytes);
+}
+
+
+/*
+ * Return a new array of every call site, with the sites of one line
+ * that were recorded under different copies of the file name, or in
+ * different shards, merged, and store its length in '*n'.  Must be
+ * called with every shard locked.
+ */
+
+static mem_site *
+collect_sites(size_t *n)
+{
+    mem_site *all, *s;
+    pool_shard *p;
+    size_t i, count = 0;
+    int j;
+
+    for (j = 0; j < NSHARDS; j++)
+    {
+        count += shards[j].s.sites_count;
+    }
+
+    all = (mem_site *)malloc((count + 1) * sizeof(mem_site));
+
+    if (all == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    count = 0;
+
+    for (j = 0; j < NSHARDS; j++)
+    {
+        p = &shards[j].s;
+
+        for (i = 0; i < p->sites_size; i++)
+        {
+            if (p->sites[i] != NULL)
+            {
+                all[count++] = *p->sites[i];
+            }
+        }
+    }
+
+    qsort(all, count, sizeof(mem_site), compare_site_location);
+
+    /* Sites with the same location are now next to each other. */
+    *n = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        if (*n > 0 && compare_site_location(&all[*n - 1], &all[i]) == 0)
+        {
+            s = &all[*n - 1];
+            s->live_bytes  += all[i].live_bytes;
+            s->live_count  += all[i].live_count;
+            s->peak_bytes  += all[i].peak_bytes;  /* an upper bound */
+            s->total_bytes += all[i].total_bytes;
+            s->nallocs     += all[i].nallocs;
+        }
+        else
+        {
+            all[(*n)++] = all[i];
+        }
+    }
+
+    return all;
+}
+
+
+/*
+ * Return the bytes live in the whole pool, and store in '*peak' the sum
+ * of each shard's peak (the true peak when one thread allocates, and an
+ * upper bound on it otherwise).  Every shard must be locked.
+ */
+
+static size_t
+total_live_bytes(size_t *peak)
+{
+    size_t live = 0;
+    int i;
+
+    *peak = 0;
+
+    for (i = 0; i < NSHARDS; i++)
+    {
+        live  += shards[i].s.live_bytes;
+        *peak += shards[i].s.peak_bytes;
+    }
+
+    return live;
+}
+
+
+/*
+ * Print the 'max_sites' call sites that allocated the most bytes, with
+ * their allocation counts and their peak and current use, to stderr.
+ * May be called at any time.
+ */
+
+void
+print_memory_profile(int max_sites)
+{
+    mem_site *all;
+    size_t n, i, live, peak;
+
+    lock_all_shards();
+    all = collect_sites(&n);
+    qsort(all, n, sizeof(mem_site), compare_site_total);
+    live = total_live_bytes(&peak);
+
+    fprintf(stderr, "Memory profile: %lu bytes live, %lu at peak, "
+                    "%lu call sites.\n",
+            (unsigned long)live, (unsigned long)peak, (unsigned long)n);
+
+    if (sample_interval != 0)
+    {
+        fprintf(stderr, "(Estimated from allocations sampled once per "
+                        "%lu bytes.)\n", (unsigned long)sample_interval);
+    }
+
+    fprintf(stderr, "%14s %10s %12s %12s %10s  %s\n", "bytes", "allocs",
+            "peak bytes", "live bytes", "live", "site");
+
+    for (i = 0; i < n && (max_sites <= 0 || i < (size_t)max_sites); i++)
+    {
+        fprintf(stderr, "%14lu %10lu %12lu %12lu %10lu  %s:%d\n",
+                (unsigned long)all[i].total_bytes, all[i].nallocs,
+                (unsigned long)all[i].peak_bytes,
+                (unsigned long)all[i].live_bytes,
+                (unsigned long)all[i].live_count,
+                all[i].filename, all[i].lineno);
+    }
+
+    free(all);
+    unlock_all_shards();
+}
+
+
+/*
+ * This function is intended to be called at the end of a program only.
+ * It goes through the memory pool node-by-node and prints out information
+ * on the contents of the node.  Any nodes that exist at the end of the
+ * program represent leaked memory.  Past the first MAX_LEAK_LINES, the
+ * leaks are summed up by call site instead.  When sampling, only the
+ * sampled blocks can be listed, and the sums estimate all the leaks.
+ *
+ * In a guard mode, the canaries of the leaked blocks are checked too.
+ *
+ * If the environment variable MEMCHECK_PROFILE is set, the profile of
+ * that many call sites (all of them for 0) is printed first.  The
+ * event log, if any, is brought up to date; the leaked blocks are left
+ * live in it.
+ */
+
+void
+print_memory_leaks(void)
+{
+    mem_node *n, *pool;
+    mem_site *all;
+    size_t nleaks = 0, nsites, nblocks = 0, i, peak;
+    char *profile = getenv("MEMCHECK_PROFILE");
+    int j;
+
+    if (profile != NULL)
+    {
+        print_memory_profile(atoi(profile));
+    }
+
+    lock_all_shards();
+
+    for (j = 0; j < NSHARDS; j++)
+    {
+        pool = &shards[j].s.pool;
+
+        for (n = pool->next; n != pool; n = n->next)
+        {
+            if (!canary_intact(n))
+            {
+                fprintf(stderr,
+                        "Buffer overrun: past the %d bytes allocated at "
+                        "%p in file: %s, line: %d.\n",
+                        (int)n->nbytes, BLOCK_OF(n), n->site->filename,
+                        n->site->lineno);
+            }
+
+            if (nleaks++ < MAX_LEAK_LINES)
+            {
+                fprintf(stderr,
+                        "Memory leak: %d bytes allocated at %p in "
+                        "file: %s, line: %d.\n",
+                        (int)n->nbytes, BLOCK_OF(n), n->site->filename,
+                        n->site->lineno);
+            }
+        }
+    }
+
+    if (nleaks > MAX_LEAK_LINES || (nleaks > 0 && sample_interval != 0))
+    {
+        all = collect_sites(&nsites);
+        qsort(all, nsites, sizeof(mem_site), compare_site_live);
+
+        if (sample_interval == 0)
+        {
+            fprintf(stderr, "Memory leaks: %lu blocks, %lu bytes in all, "
+                            "by call site:\n",
+                    (unsigned long)nleaks,
+                    (unsigned long)total_live_bytes(&peak));
+        }
+        else
+        {
+            for (i = 0; i < nsites; i++)
+            {
+                nblocks += all[i].live_count;
+            }
+
+            fprintf(stderr, "Memory leaks: about %lu blocks, %lu bytes in "
+                            "all (from %lu sampled), by call site:\n",
+                    (unsigned long)nblocks,
+                    (unsigned long)total_live_bytes(&peak),
+                    (unsigned long)nleaks);
+        }
+
+        for (i = 0; i < nsites && all[i].live_count > 0; i++)
+        {
+            fprintf(stderr, "  %lu bytes in %lu blocks at file: %s, "
+                            "line: %d.\n",
+                    (unsigned long)all[i].live_bytes,
+                    (unsigned long)all[i].live_count,
+                    all[i].filename, all[i].lineno);
+        }
+
+        free(all);
+    }
+
+    flush_all_logs();
+    free_all_mem_nodes();
+    unlock_all_shards();
+}
@@ -0,0 +1,132 @@
+/*
+ * FILE: memcheck.h
+ *
+ *       Interface to the memory leak checker.
+ *
+ */
+
+#ifndef MEMCHECK_H
+#define MEMCHECK_H
+
+/* Included before the macros below redefine names they declare. */
+#include <stdlib.h>
+#include <string.h>
+
+void *checked_malloc_fn(size_t size, char *filename, int lineno);
+void *checked_calloc_fn(size_t nmemb, size_t size,
+                        char *filename, int lineno);
+void  checked_free_fn(void *ptr, char *filename, int lineno);
+void *checked_realloc_fn(void *ptr, size_t size, char *filename, int lineno);
+char *checked_strdup_fn(const char *s, char *filename, int lineno);
+char *checked_strndup_fn(const char *s, size_t n,
+                         char *filename, int lineno);
+void *checked_aligned_alloc_fn(size_t alignment, size_t size,
+                               char *filename, int lineno);
+void  print_memory_leaks(void);
+
+/*
+ * Print the 'max_sites' call sites (every one if 'max_sites' is 0)
+ * that allocated the most bytes, with their counts and their peak and
+ * live bytes, to stderr.  Setting MEMCHECK_PROFILE=n in the environment
+ * makes print_memory_leaks() print this first.
+ */
+void  print_memory_profile(int max_sites);
+
+/*
+ * Track only about one allocation per 'interval' bytes allocated, picked
+ * at random, or every allocation for 0 (the default).  The rest cost
+ * next to nothing, and the reports scale the sampled blocks up to
+ * estimate the totals.  Setting MEMCHECK_SAMPLE=interval in the
+ * environment does the same from the start.
+ */
+void  set_memory_sampling(size_t interval);
+
+/*
+ * Event log.  Setting MEMCHECK_LOG=file in the environment makes
+ * memcheck write an event to 'file' each time it starts tracking a
+ * block, resizes one or frees one (so with sampling, only the sampled
+ * blocks are logged).  Events are buffered, and the buffers are written
+ * out when full and by print_memory_leaks(); blocks still live then
+ * are the leaks.
+ *
+ * The file is a sequence of memcheck_event records in the machine's own
+ * byte order.  The first is a MEMLOG_START record.  A MEMLOG_SITE record
+ * comes before the first event of each call site, and is followed by the
+ * site's file name, padded with zero bytes to a whole number of records.
+ * Records are in time order for each thread, but not across threads.
+ *
+ * Times are in ticks of the processor's time stamp counter where there
+ * is one.  Each buffer of events written out ends with a MEMLOG_CLOCK
+ * record, giving the nanoseconds since the start at its tick count, and
+ * the ticks are converted to time by the rate between the first and
+ * the last of those.
+ */
+
+typedef struct
+{
+    unsigned long time;     /* Clock ticks (see above).                 */
+    unsigned long addr;     /* The block; the line number for a site.   */
+    unsigned long old_addr; /* Where a resized block was before.        */
+    unsigned long size;     /* Bytes in the block, or as noted below.   */
+    unsigned int  site;     /* Number of the call site.                 */
+    unsigned int  op;       /* One of the MEMLOG_ operations below.     */
+}
+memcheck_event;
+
+#define MEMLOG_START    1   /* 'addr' is MEMLOG_MAGIC, 'size' the       */
+                            /* sample interval; at 0 nanoseconds.       */
+#define MEMLOG_ALLOC    2
+#define MEMLOG_FREE     3
+#define MEMLOG_REALLOC  4
+#define MEMLOG_SITE     5   /* 'size' is the length of the file name.   */
+#define MEMLOG_SAMPLE   6   /* 'size' is the new sample interval.       */
+#define MEMLOG_CLOCK    7   /* 'size' is nanoseconds since the start.   */
+
+#define MEMLOG_MAGIC    0x6D656D6C6F67UL
+
+/*
+ * Macros which maintain the interface of the standard malloc/calloc/free
+ * functions, and of realloc, strdup/strndup and aligned_alloc (which
+ * can be used whether or not the C library declares them).  Don't
+ * include these if this file is being included into memcheck.c, or it
+ * will screw up the definitions of the checked functions.
+ * Defining MEMCHECK_DISABLE (e.g. for benchmarks and releases) leaves
+ * out those for malloc, calloc, free and realloc, so the standard
+ * functions are called directly, and makes the reports do nothing.
+ * -ansi declares none of strdup, strndup and aligned_alloc, so those
+ * still go to the checked functions, and a program that uses them must
+ * be linked with libmemcheck_release.a, whose versions do no checking.
+ */
+
+#if !defined(MEMCHECK_C) && !defined(MEMCHECK_DISABLE)
+
+#define malloc(n)           checked_malloc_fn((n), __FILE__, __LINE__)
+#define calloc(n, m)        checked_calloc_fn((n), (m), __FILE__, __LINE__)
+#define free(p)             checked_free_fn((p), __FILE__, __LINE__)
+#define realloc(p, n)       checked_realloc_fn((p), (n), __FILE__, __LINE__)
+#define strdup(s)           checked_strdup_fn((s), __FILE__, __LINE__)
+#define strndup(s, n)       checked_strndup_fn((s), (n), __FILE__, __LINE__)
+#define aligned_alloc(a, n) \
+        checked_aligned_alloc_fn((a), (n), __FILE__, __LINE__)
+
+#endif  /* !MEMCHECK_C && !MEMCHECK_DISABLE */
+
+#if !defined(MEMCHECK_C) && defined(MEMCHECK_DISABLE)
+
+#define strdup(s)           checked_strdup_fn((s), __FILE__, __LINE__)
+#define strndup(s, n)       checked_strndup_fn((s), (n), __FILE__, __LINE__)
+#define aligned_alloc(a, n) \
+        checked_aligned_alloc_fn((a), (n), __FILE__, __LINE__)
+
+#endif  /* !MEMCHECK_C && MEMCHECK_DISABLE */
+
+#ifdef MEMCHECK_DISABLE
+
+#define print_memory_leaks()        ((void)0)
+#define print_memory_profile(n)     ((void)(n))
+#define set_memory_sampling(n)      ((void)(n))
+
+#endif  /* MEMCHECK_DISABLE */
+
+#endif  /* MEMCHECK_H */
+
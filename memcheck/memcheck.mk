@@ -0,0 +1,46 @@
+#
+# Settings for building a program with memcheck, included by the
+# assignments' Makefiles after they set MEMCHECK_DIR.
+#
+# MEMCHECK chooses what becomes of the memcheck.h macros:
+#
+#   track    (the default) every block is tracked and leaks reported
+#   release  the same objects, linked with libmemcheck_release.a, whose
+#            functions just call the C library: a swap at link time
+#   slab     the same again, linked with libmemcheck_slab.a, whose
+#            functions take small blocks from slab.c's size classes
+#   off      the macros are compiled out, so malloc() and the rest are
+#            the C library's own; libmemcheck_release.a is linked only
+#            for strdup(), strndup() and aligned_alloc(), which -ansi
+#            doesn't declare
+#
+# e.g. "make MEMCHECK=off".  Switching between "off" and the others
+# needs a "make clean", since the objects differ.
+#
+
+MEMCHECK = track
+
+MEMCHECK_H    = $(MEMCHECK_DIR)/memcheck.h
+MEMCHECK_SRCS = $(MEMCHECK_DIR)/memcheck.c \
+                $(MEMCHECK_DIR)/memcheck_release.c $(MEMCHECK_H) \
+                $(MEMCHECK_DIR)/slab.c $(MEMCHECK_DIR)/slab.h
+
+MEMCHECK_CFLAGS_track   = -I$(MEMCHECK_DIR)
+MEMCHECK_CFLAGS_release = -I$(MEMCHECK_DIR)
+MEMCHECK_CFLAGS_slab    = -I$(MEMCHECK_DIR)
+MEMCHECK_CFLAGS_off     = -I$(MEMCHECK_DIR) -DMEMCHECK_DISABLE
+
+MEMCHECK_LIB_track   = $(MEMCHECK_DIR)/libmemcheck.a
+MEMCHECK_LIB_release = $(MEMCHECK_DIR)/libmemcheck_release.a
+MEMCHECK_LIB_slab    = $(MEMCHECK_DIR)/libmemcheck_slab.a
+MEMCHECK_LIB_off     = $(MEMCHECK_LIB_release)
+
+MEMCHECK_LIBS_track   = $(MEMCHECK_LIB_track) -pthread
+MEMCHECK_LIBS_release = $(MEMCHECK_LIB_release)
+MEMCHECK_LIBS_slab    = $(MEMCHECK_LIB_slab) -pthread
+MEMCHECK_LIBS_off     = $(MEMCHECK_LIB_release)
+
+# Flags for compiling, the library to depend on, and what to link.
+MEMCHECK_CFLAGS = $(MEMCHECK_CFLAGS_$(MEMCHECK))
+MEMCHECK_LIB    = $(MEMCHECK_LIB_$(MEMCHECK))
+MEMCHECK_LIBS   = $(MEMCHECK_LIBS_$(MEMCHECK))
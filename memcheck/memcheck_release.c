@@ -0,0 +1,136 @@
+/*
+ * FILE: memcheck_release.c
+ *
+ *       The checked functions of memcheck.h without the checking, to link
+ *       in place of memcheck.c: each calls the C library directly, and
+ *       the reports print nothing.  Objects compiled with the memcheck.h
+ *       macros can then be linked either way without being recompiled.
+ *       (To leave out even these calls, compile with MEMCHECK_DISABLE;
+ *       only strdup(), strndup() and aligned_alloc() still come here.)
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMCHECK_C
+#include "memcheck.h"
+
+/*
+ * Compiled with -DMEMCHECK_SLAB, into libmemcheck_slab.a, the blocks
+ * come from the size-class allocator instead (see slab.c).
+ */
+#ifdef MEMCHECK_SLAB
+#include "slab.h"
+#define malloc(size)         slab_malloc(size)
+#define calloc(nmemb, size)  slab_calloc(nmemb, size)
+#define realloc(ptr, size)   slab_realloc(ptr, size)
+#define free(ptr)            slab_free(ptr)
+#endif
+
+
+void *
+checked_malloc_fn(size_t size, char *filename, int lineno)
+{
+    return malloc(size);
+}
+
+
+void *
+checked_calloc_fn(size_t nmemb, size_t size, char *filename, int lineno)
+{
+    return calloc(nmemb, size);
+}
+
+
+void
+checked_free_fn(void *ptr, char *filename, int lineno)
+{
+    free(ptr);
+}
+
+
+void *
+checked_realloc_fn(void *ptr, size_t size, char *filename, int lineno)
+{
+    return realloc(ptr, size);
+}
+
+
+/*
+ * strdup(), strndup() and aligned_alloc() aren't declared under -ansi,
+ * so these are written out (aligned_alloc() with posix_memalign()).
+ */
+
+char *
+checked_strdup_fn(const char *s, char *filename, int lineno)
+{
+    size_t len = strlen(s);
+    char *copy = (char *)malloc(len + 1);
+
+    if (copy != NULL)
+    {
+        memcpy(copy, s, len + 1);
+    }
+
+    return copy;
+}
+
+
+char *
+checked_strndup_fn(const char *s, size_t n, char *filename, int lineno)
+{
+    size_t len = 0;
+    char *copy;
+
+    while (len < n && s[len] != '\0')
+    {
+        len++;
+    }
+
+    copy = (char *)malloc(len + 1);
+
+    if (copy != NULL)
+    {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+
+    return copy;
+}
+
+
+void *
+checked_aligned_alloc_fn(size_t alignment, size_t size,
+                         char *filename, int lineno)
+{
+    void *block;
+
+    if (alignment < sizeof(void *))
+    {
+        alignment = sizeof(void *);
+    }
+
+    return posix_memalign(&block, alignment, size) == 0 ? block : NULL;
+}
+
+
+void
+print_memory_leaks(void)
+{
+}
+
+
+void
+print_memory_profile(int max_sites)
+{
+}
+
+
+void
+set_memory_sampling(size_t interval)
+{
+}
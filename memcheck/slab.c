@@ -0,0 +1,471 @@
+/*
+ * FILE: slab.c
+ *
+ *       Size-class allocator for small blocks.  Lists and tables
+ *       allocate great numbers of blocks of a few sizes, and malloc()
+ *       spends time and a header on each; here every size up to
+ *       SLAB_MAX is rounded up to a multiple of 8, and served from
+ *       chunks that hold blocks of that one class, with a free list
+ *       per class.  A block carries no header, and allocating or freeing
+ *       one takes the head of a list or pushes it back.
+ *
+ *       The chunks all lie in one region of address space reserved at
+ *       the start, so one comparison tells a slab block from one of
+ *       malloc()'s, and a chunk's class is looked up from its address.
+ *       Blocks whose size is a multiple of 16 are 16-byte aligned, and
+ *       the rest are 8-byte aligned, which is all they can need.
+ *
+ *       When built with -DMEMCHECK_THREADS, each thread keeps free lists
+ *       of its own, so most calls take no lock.  When a thread's list
+ *       runs out, it takes blocks from the class's shared list, or new
+ *       ones, under the class's lock.  Freed blocks go to the freeing
+ *       thread, up to CACHE_BLOCKS per class; beyond that they are moved
+ *       to the shared list, so a thread that frees what others allocate
+ *       doesn't hoard them.  When a thread exits, its lists are added to
+ *       the shared ones.  Slabs are never given back to the system.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef MEMCHECK_THREADS
+#include <pthread.h>
+#endif
+
+#include "slab.h"
+
+#ifdef MEMCHECK_THREADS
+#define THREAD_LOCAL __thread
+#define LOCK(m)      pthread_mutex_lock(m)
+#define UNLOCK(m)    pthread_mutex_unlock(m)
+#else
+#define THREAD_LOCAL
+#define LOCK(m)
+#define UNLOCK(m)
+#endif
+
+/* Size classes: every multiple of CLASS_STEP bytes up to SLAB_MAX. */
+#define CLASS_STEP     8
+#define NCLASSES       (SLAB_MAX / CLASS_STEP)
+#define CLASS_OF(n)    ((n) == 0 ? 0 : ((n) - 1) / CLASS_STEP)
+#define CLASS_SIZE(c)  (((c) + 1) * CLASS_STEP)
+
+/*
+ * Chunks are CHUNK_SIZE bytes, handed out in order from a region of
+ * REGION_SIZE bytes, which is reserved inaccessible and made
+ * accessible a chunk at a time, so it only takes memory as it is used.
+ * Once it is full, blocks come from malloc().
+ */
+#define CHUNK_SIZE   (64 * 1024)
+#define REGION_SIZE  ((size_t)1 << 30)
+#define NCHUNKS      (REGION_SIZE / CHUNK_SIZE)
+
+/* Blocks a thread takes at a time when its list runs out, and the most
+ * it keeps; freeing past CACHE_BLOCKS moves REFILL_BLOCKS of them to the
+ * shared list. */
+#define REFILL_BLOCKS 64
+#define CACHE_BLOCKS  (2 * REFILL_BLOCKS)
+
+
+/* A free block, linked through its first word. */
+typedef
+struct _free_block
+{
+    struct _free_block *next;
+}
+free_block;
+
+/* A size class. */
+typedef
+struct _slab_class
+{
+#ifdef MEMCHECK_THREADS
+    pthread_mutex_t lock;
+#endif
+    free_block *shared;     /* Blocks given up by other threads.          */
+    char       *next;       /* The rest of the class's newest chunk.      */
+    char       *end;
+}
+slab_class;
+
+static slab_class classes[NCLASSES];
+
+static char  *region      = NULL;
+static size_t region_size = 0;      /* 0 until the region is reserved. */
+static size_t nchunks     = 0;      /* Chunks handed out.              */
+static unsigned char chunk_class[NCHUNKS];
+
+/* The calling thread's free lists. */
+static THREAD_LOCAL free_block *cache[NCLASSES];
+static THREAD_LOCAL int cache_count[NCLASSES];
+static THREAD_LOCAL int thread_started = 0;
+
+#ifdef MEMCHECK_THREADS
+static pthread_once_t  region_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t   cache_key;
+#endif
+
+
+/*
+ * Add an exiting thread's free lists to the shared ones.
+ */
+
+#ifdef MEMCHECK_THREADS
+static void
+return_cache(void *unused)
+{
+    free_block *tail;
+    int c;
+
+    for (c = 0; c < NCLASSES; c++)
+    {
+        if (cache[c] != NULL)
+        {
+            for (tail = cache[c]; tail->next != NULL; tail = tail->next)
+            {
+            }
+
+            LOCK(&classes[c].lock);
+            tail->next = classes[c].shared;
+            classes[c].shared = cache[c];
+            UNLOCK(&classes[c].lock);
+            cache[c] = NULL;
+            cache_count[c] = 0;
+        }
+    }
+}
+#endif
+
+
+/*
+ * Reserve the region, from /dev/zero (as MAP_ANONYMOUS isn't POSIX).
+ * If that fails, every block comes from malloc().
+ */
+
+static void
+init_region(void)
+{
+    void *map;
+    int fd;
+#ifdef MEMCHECK_THREADS
+    int c;
+
+    for (c = 0; c < NCLASSES; c++)
+    {
+        pthread_mutex_init(&classes[c].lock, NULL);
+    }
+
+    pthread_key_create(&cache_key, return_cache);
+#endif
+
+    fd = open("/dev/zero", O_RDONLY);
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+    map = mmap(NULL, REGION_SIZE, PROT_NONE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map != MAP_FAILED)
+    {
+        region      = (char *)map;
+        region_size = REGION_SIZE;
+    }
+}
+
+
+/*
+ * Set up the region, if not yet, and see that the calling thread's
+ * lists will be handed on when it exits.
+ */
+
+static void
+start_thread(void)
+{
+    thread_started = 1;
+
+#ifdef MEMCHECK_THREADS
+    pthread_once(&region_once, init_region);
+    pthread_setspecific(cache_key, &thread_started);
+#else
+    init_region();
+#endif
+}
+
+
+/*
+ * Give class 'c' a new chunk to carve blocks from.  Return 0 if the
+ * region is full or can't be used.  The class must be locked.
+ */
+
+static int
+new_chunk(int c)
+{
+    char *chunk = NULL;
+
+    LOCK(&region_lock);
+
+    if (nchunks < region_size / CHUNK_SIZE)
+    {
+        chunk = region + nchunks * CHUNK_SIZE;
+
+        if (mprotect(chunk, CHUNK_SIZE, PROT_READ | PROT_WRITE) == 0)
+        {
+            chunk_class[nchunks++] = (unsigned char)c;
+        }
+        else
+        {
+            chunk = NULL;
+        }
+    }
+
+    UNLOCK(&region_lock);
+
+    if (chunk == NULL)
+    {
+        return 0;
+    }
+
+    classes[c].next = chunk;
+    classes[c].end  = chunk + CHUNK_SIZE;
+    return 1;
+}
+
+
+/*
+ * Fill the calling thread's empty list for class 'c' with up to
+ * REFILL_BLOCKS blocks, from the shared list or else from the class's
+ * chunk, and return it; or return NULL if there are no more slabs.
+ */
+
+static free_block *
+refill(int c)
+{
+    slab_class *k = &classes[c];
+    size_t size = CLASS_SIZE(c);
+    free_block *list = NULL, **tail = &list;
+    int i = 0;
+
+    if (!thread_started)
+    {
+        start_thread();
+    }
+
+    LOCK(&k->lock);
+
+    if (k->shared != NULL)
+    {
+        list = k->shared;
+
+        for (i = 1; i < REFILL_BLOCKS && (*tail)->next != NULL; i++)
+        {
+            tail = &(*tail)->next;
+        }
+
+        k->shared = (*tail)->next;
+        (*tail)->next = NULL;
+    }
+    else
+    {
+        for (i = 0; i < REFILL_BLOCKS; i++)
+        {
+            if (k->next + size > k->end && !new_chunk(c))
+            {
+                break;
+            }
+
+            *tail = (free_block *)k->next;
+            tail = &(*tail)->next;
+            k->next += size;
+        }
+
+        *tail = NULL;
+    }
+
+    UNLOCK(&k->lock);
+    cache[c] = list;
+    cache_count[c] = i;
+    return list;
+}
+
+
+/*
+ * Move REFILL_BLOCKS blocks from the calling thread's full list for
+ * class 'c' to the shared list.
+ */
+
+static void
+spill(int c)
+{
+    free_block *first = cache[c], *last = cache[c];
+    int i;
+
+    for (i = 1; i < REFILL_BLOCKS; i++)
+    {
+        last = last->next;
+    }
+
+    cache[c] = last->next;
+    cache_count[c] -= REFILL_BLOCKS;
+
+    LOCK(&classes[c].lock);
+    last->next = classes[c].shared;
+    classes[c].shared = first;
+    UNLOCK(&classes[c].lock);
+}
+
+
+/*
+ * Return the class of a block, or -1 if it isn't a slab block (which
+ * includes NULL).
+ */
+
+static int
+class_of_block(void *ptr)
+{
+    size_t offset = (size_t)ptr - (size_t)region;
+
+    return offset < region_size ? chunk_class[offset / CHUNK_SIZE] : -1;
+}
+
+
+void *
+slab_malloc(size_t size)
+{
+    free_block *b;
+    int c;
+
+    if (size > SLAB_MAX)
+    {
+        return malloc(size);
+    }
+
+    c = CLASS_OF(size);
+    b = cache[c];
+
+    if (b == NULL && (b = refill(c)) == NULL)
+    {
+        return malloc(size);
+    }
+
+    cache[c] = b->next;
+    cache_count[c]--;
+    return b;
+}
+
+
+void *
+slab_calloc(size_t nmemb, size_t size)
+{
+    void *block;
+
+    if (size != 0 && nmemb > (size_t)-1 / size)
+    {
+        return NULL;
+    }
+
+    if (nmemb * size > SLAB_MAX)
+    {
+        return calloc(nmemb, size);
+    }
+
+    block = slab_malloc(nmemb * size);
+
+    if (block != NULL)
+    {
+        memset(block, 0, nmemb * size);
+    }
+
+    return block;
+}
+
+
+/*
+ * A slab block stays where it is if the new size is of the same class,
+ * and otherwise moves; malloc()'s blocks are left to realloc().  A size
+ * of 0 frees the block and returns NULL, as the GNU C library does.
+ */
+
+void *
+slab_realloc(void *ptr, size_t size)
+{
+    int c = class_of_block(ptr);
+    size_t old_size;
+    void *block;
+
+    if (c < 0)
+    {
+        return ptr == NULL ? slab_malloc(size) : realloc(ptr, size);
+    }
+
+    if (size == 0)
+    {
+        slab_free(ptr);
+        return NULL;
+    }
+
+    if (size <= SLAB_MAX && (int)CLASS_OF(size) == c)
+    {
+        return ptr;
+    }
+
+    old_size = CLASS_SIZE(c);
+    block = slab_malloc(size);
+
+    if (block != NULL)
+    {
+        memcpy(block, ptr, size < old_size ? size : old_size);
+        slab_free(ptr);
+    }
+
+    return block;
+}
+
+
+void
+slab_free(void *ptr)
+{
+    free_block *b = (free_block *)ptr;
+    int c = class_of_block(ptr);
+
+    if (c < 0)
+    {
+        free(ptr);
+        return;
+    }
+
+    if (!thread_started)
+    {
+        start_thread();
+    }
+
+    b->next = cache[c];
+    cache[c] = b;
+
+    if (++cache_count[c] > CACHE_BLOCKS)
+    {
+        spill(c);
+    }
+}
+
+
+size_t
+slab_footprint(void)
+{
+    size_t n;
+
+    LOCK(&region_lock);
+    n = nchunks * CHUNK_SIZE;
+    UNLOCK(&region_lock);
+    return n;
+}
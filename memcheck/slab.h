@@ -0,0 +1,27 @@
+/*
+ * FILE: slab.h
+ *
+ *       Interface to the size-class allocator, an optional backend for
+ *       memcheck (see slab.c).  The functions behave like the C
+ *       library's, and blocks from either may be given to slab_free()
+ *       and slab_realloc().
+ *
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+/* Largest block served from the slabs; larger ones come from malloc(). */
+#define SLAB_MAX 256
+
+void   *slab_malloc(size_t size);
+void   *slab_calloc(size_t nmemb, size_t size);
+void   *slab_realloc(void *ptr, size_t size);
+void    slab_free(void *ptr);
+
+/* Bytes of memory taken from the system for slabs so far. */
+size_t  slab_footprint(void);
+
+#endif  /* SLAB_H */